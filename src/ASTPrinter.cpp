@@ -24,12 +24,11 @@ void ASTPrinter::print( Expr* expr )
 
 void ASTPrinter::visit( Binary* expr )
 {
-    parenthesize( expr->op.getLexeme(),
-                  { expr->left.get(), expr->right.get() } );
+    parenthesize( expr->op.getLexeme(), { expr->left, expr->right } );
 }
 void ASTPrinter::visit( Grouping* expr )
 {
-    parenthesize( "group", { expr->expr.get() } );
+    parenthesize( "group", { expr->expr } );
 }
 
 void ASTPrinter::visit( Literal* expr )
@@ -39,7 +38,7 @@ void ASTPrinter::visit( Literal* expr )
 
 void ASTPrinter::visit( Unary* expr )
 {
-    parenthesize( expr->op.getLexeme(), { expr->right.get() } );
+    parenthesize( expr->op.getLexeme(), { expr->right } );
 }
 
 const std::string& ASTPrinter::getTree() const
@@ -0,0 +1,35 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "Arena.h"
+
+Arena::~Arena()
+{
+    for ( auto it = m_finalizers.rbegin(); it != m_finalizers.rend(); ++it )
+        it->destroy( it->objects, it->count );
+}
+
+void* Arena::allocate( std::size_t size, std::size_t alignment )
+{
+    auto address = reinterpret_cast<std::uintptr_t>( m_next );
+    std::size_t padding = ( alignment - address % alignment ) % alignment;
+
+    if ( !m_next || padding + size > static_cast<std::size_t>( m_end - m_next ) )
+    {
+        // Oversized requests get a chunk of their own.
+        std::size_t chunkSize = std::max( CHUNK_SIZE, size + alignment );
+        m_chunks.emplace_back( new std::byte[chunkSize] );
+        m_next = m_chunks.back().get();
+        m_end = m_next + chunkSize;
+
+        address = reinterpret_cast<std::uintptr_t>( m_next );
+        padding = ( alignment - address % alignment ) % alignment;
+    }
+
+    void* memory = m_next + padding;
+    m_next += padding + size;
+    m_bytesUsed += size;
+    return memory;
+}
\ No newline at end of file
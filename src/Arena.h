@@ -0,0 +1,132 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// A fixed-size run of elements stored in an Arena, used for the child lists
+// of AST nodes. It does not own its elements.
+template <typename T>
+class NodeList
+{
+public:
+    NodeList() = default;
+
+    NodeList( T* data, std::uint32_t size ) : m_data{ data }, m_size{ size }
+    {
+    }
+
+    T* begin() const
+    {
+        return m_data;
+    }
+
+    T* end() const
+    {
+        return m_data + m_size;
+    }
+
+    T& operator[]( std::size_t index ) const
+    {
+        return m_data[index];
+    }
+
+    std::size_t size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+
+private:
+    T* m_data{ nullptr };
+    std::uint32_t m_size{ 0 };
+};
+
+// Bump allocator owning the AST of one parsed program. Nodes are packed into
+// large chunks in the order the Parser creates them, so a tree walk touches
+// memory mostly front to back, and the whole program is freed at once when
+// the arena is destroyed.
+class Arena
+{
+public:
+    Arena() = default;
+    Arena( const Arena& ) = delete;
+    Arena& operator=( const Arena& ) = delete;
+    ~Arena();
+
+    template <typename T, typename... Args>
+    T* make( Args&&... args )
+    {
+        void* memory = allocate( sizeof( T ), alignof( T ) );
+        T* object = new ( memory ) T( std::forward<Args>( args )... );
+        addFinalizer( object, 1 );
+        return object;
+    }
+
+    // Moves the items into the arena. The vector is left empty so a caller
+    // can reuse its capacity.
+    template <typename T>
+    NodeList<T> list( std::vector<T>& items )
+    {
+        if ( items.empty() )
+            return NodeList<T>{};
+
+        T* data = static_cast<T*>(
+            allocate( sizeof( T ) * items.size(), alignof( T ) ) );
+        std::uninitialized_move( items.begin(), items.end(), data );
+        addFinalizer( data, items.size() );
+
+        NodeList<T> result{ data,
+                            static_cast<std::uint32_t>( items.size() ) };
+        items.clear();
+        return result;
+    }
+
+    std::size_t getBytesUsed() const
+    {
+        return m_bytesUsed;
+    }
+
+private:
+    static constexpr std::size_t CHUNK_SIZE = 64 * 1024;
+
+    // Nodes hold tokens and values, which own references, so the arena
+    // still runs their destructors before releasing the chunks.
+    struct Finalizer
+    {
+        void ( *destroy )( void* objects, std::size_t count );
+        void* objects;
+        std::size_t count;
+    };
+
+    template <typename T>
+    void addFinalizer( T* objects, std::size_t count )
+    {
+        if constexpr ( !std::is_trivially_destructible_v<T> )
+        {
+            m_finalizers.push_back(
+                { []( void* objects, std::size_t count )
+                  {
+                      T* first = static_cast<T*>( objects );
+                      for ( std::size_t i = 0; i < count; ++i )
+                          first[i].~T();
+                  },
+                  objects, count } );
+        }
+    }
+
+    void* allocate( std::size_t size, std::size_t alignment );
+
+    std::vector<std::unique_ptr<std::byte[]>> m_chunks{};
+    std::byte* m_next{ nullptr };
+    std::byte* m_end{ nullptr };
+    std::size_t m_bytesUsed{ 0 };
+    std::vector<Finalizer> m_finalizers{};
+};
\ No newline at end of file
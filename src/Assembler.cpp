@@ -0,0 +1,320 @@
+#include <cassert>
+#include <cstring>
+
+#include "Assembler.h"
+
+namespace
+{
+    std::uint8_t code( Assembler::Register reg )
+    {
+        return static_cast<std::uint8_t>( reg );
+    }
+
+    std::uint8_t code( Assembler::Xmm reg )
+    {
+        return static_cast<std::uint8_t>( reg );
+    }
+
+    std::uint8_t code( Assembler::Condition condition )
+    {
+        return static_cast<std::uint8_t>( condition );
+    }
+} // namespace
+
+void Assembler::bind( Label& label )
+{
+    label.offset = static_cast<std::int64_t>( m_code.size() );
+    for ( std::size_t use : label.uses )
+    {
+        patch32( use, static_cast<std::int32_t>( label.offset -
+                                                 static_cast<std::int64_t>(
+                                                     use + 4 ) ) );
+    }
+    label.uses.clear();
+}
+
+void Assembler::push( Register reg )
+{
+    byte( static_cast<std::uint8_t>( 0x50 + code( reg ) ) );
+}
+
+void Assembler::pop( Register reg )
+{
+    byte( static_cast<std::uint8_t>( 0x58 + code( reg ) ) );
+}
+
+void Assembler::ret()
+{
+    byte( 0xc3 );
+}
+
+void Assembler::mov( Register dst, Register src )
+{
+    rexW();
+    byte( 0x89 );
+    modrm( 0b11, code( src ), code( dst ) );
+}
+
+void Assembler::mov( Register dst, std::uint64_t imm )
+{
+    rexW();
+    byte( static_cast<std::uint8_t>( 0xb8 + code( dst ) ) );
+    for ( int i = 0; i < 8; ++i )
+        byte( static_cast<std::uint8_t>( imm >> ( 8 * i ) ) );
+}
+
+void Assembler::load( Register dst, Register base, std::int32_t disp )
+{
+    rexW();
+    byte( 0x8b );
+    memory( code( dst ), base, disp );
+}
+
+void Assembler::store( Register base, std::int32_t disp, Register src )
+{
+    rexW();
+    byte( 0x89 );
+    memory( code( src ), base, disp );
+}
+
+void Assembler::lea( Register dst, Register base, std::int32_t disp )
+{
+    rexW();
+    byte( 0x8d );
+    memory( code( dst ), base, disp );
+}
+
+void Assembler::add( Register dst, std::int32_t imm )
+{
+    rexW();
+    byte( 0x81 );
+    modrm( 0b11, 0, code( dst ) );
+    int32( imm );
+}
+
+void Assembler::sub( Register dst, std::int32_t imm )
+{
+    patch32( subWithPatch( dst ), imm );
+}
+
+void Assembler::addToMemory( Register base, std::int32_t disp,
+                             std::int8_t imm )
+{
+    rexW();
+    byte( 0x83 );
+    memory( 0, base, disp );
+    byte( static_cast<std::uint8_t>( imm ) );
+}
+
+void Assembler::cmp( Register left, Register right )
+{
+    rexW();
+    byte( 0x39 );
+    modrm( 0b11, code( right ), code( left ) );
+}
+
+void Assembler::test( Register left, Register right )
+{
+    rexW();
+    byte( 0x85 );
+    modrm( 0b11, code( right ), code( left ) );
+}
+
+void Assembler::setcc( Condition condition, Register dst )
+{
+    // Without a REX prefix only AL, CL, DL and BL have byte forms.
+    assert( code( dst ) < 4 );
+    byte( 0x0f );
+    byte( static_cast<std::uint8_t>( 0x90 + code( condition ) ) );
+    modrm( 0b11, 0, code( dst ) );
+}
+
+void Assembler::movzxByte( Register dst, Register src )
+{
+    assert( code( src ) < 4 );
+    byte( 0x0f );
+    byte( 0xb6 );
+    modrm( 0b11, code( dst ), code( src ) );
+}
+
+void Assembler::andByte( Register dst, Register src )
+{
+    assert( code( dst ) < 4 && code( src ) < 4 );
+    byte( 0x20 );
+    modrm( 0b11, code( src ), code( dst ) );
+}
+
+void Assembler::orByte( Register dst, Register src )
+{
+    assert( code( dst ) < 4 && code( src ) < 4 );
+    byte( 0x08 );
+    modrm( 0b11, code( src ), code( dst ) );
+}
+
+std::size_t Assembler::subWithPatch( Register dst )
+{
+    rexW();
+    byte( 0x81 );
+    modrm( 0b11, 5, code( dst ) );
+    std::size_t offset = m_code.size();
+    int32( 0 );
+    return offset;
+}
+
+void Assembler::patch32( std::size_t offset, std::int32_t value )
+{
+    std::memcpy( &m_code[offset], &value, sizeof( value ) );
+}
+
+void Assembler::movsd( Xmm dst, Register base, std::int32_t disp )
+{
+    byte( 0xf2 );
+    byte( 0x0f );
+    byte( 0x10 );
+    memory( code( dst ), base, disp );
+}
+
+void Assembler::movsd( Register base, std::int32_t disp, Xmm src )
+{
+    byte( 0xf2 );
+    byte( 0x0f );
+    byte( 0x11 );
+    memory( code( src ), base, disp );
+}
+
+void Assembler::movapd( Xmm dst, Xmm src )
+{
+    sse( 0x66, 0x28, code( dst ), code( src ) );
+}
+
+void Assembler::movq( Xmm dst, Register src )
+{
+    byte( 0x66 );
+    rexW();
+    byte( 0x0f );
+    byte( 0x6e );
+    modrm( 0b11, code( dst ), code( src ) );
+}
+
+void Assembler::movq( Register dst, Xmm src )
+{
+    byte( 0x66 );
+    rexW();
+    byte( 0x0f );
+    byte( 0x7e );
+    modrm( 0b11, code( src ), code( dst ) );
+}
+
+void Assembler::addsd( Xmm dst, Xmm src )
+{
+    sse( 0xf2, 0x58, code( dst ), code( src ) );
+}
+
+void Assembler::subsd( Xmm dst, Xmm src )
+{
+    sse( 0xf2, 0x5c, code( dst ), code( src ) );
+}
+
+void Assembler::mulsd( Xmm dst, Xmm src )
+{
+    sse( 0xf2, 0x59, code( dst ), code( src ) );
+}
+
+void Assembler::divsd( Xmm dst, Xmm src )
+{
+    sse( 0xf2, 0x5e, code( dst ), code( src ) );
+}
+
+void Assembler::xorpd( Xmm dst, Xmm src )
+{
+    sse( 0x66, 0x57, code( dst ), code( src ) );
+}
+
+void Assembler::ucomisd( Xmm left, Xmm right )
+{
+    sse( 0x66, 0x2e, code( left ), code( right ) );
+}
+
+void Assembler::cvtsi2sd( Xmm dst, Register src )
+{
+    sse( 0xf2, 0x2a, code( dst ), code( src ) );
+}
+
+void Assembler::jump( Label& label )
+{
+    byte( 0xe9 );
+    reference( label );
+}
+
+void Assembler::jump( Condition condition, Label& label )
+{
+    byte( 0x0f );
+    byte( static_cast<std::uint8_t>( 0x80 + code( condition ) ) );
+    reference( label );
+}
+
+void Assembler::call( Label& label )
+{
+    byte( 0xe8 );
+    reference( label );
+}
+
+void Assembler::call( Register target )
+{
+    byte( 0xff );
+    modrm( 0b11, 2, code( target ) );
+}
+
+void Assembler::byte( std::uint8_t value )
+{
+    m_code.push_back( value );
+}
+
+void Assembler::int32( std::int32_t value )
+{
+    std::uint8_t bytes[sizeof( value )];
+    std::memcpy( bytes, &value, sizeof( value ) );
+    m_code.insert( m_code.end(), bytes, bytes + sizeof( value ) );
+}
+
+void Assembler::rexW()
+{
+    byte( 0x48 );
+}
+
+void Assembler::modrm( std::uint8_t mod, std::uint8_t reg, std::uint8_t rm )
+{
+    byte( static_cast<std::uint8_t>( ( mod << 6 ) | ( reg << 3 ) | rm ) );
+}
+
+void Assembler::memory( std::uint8_t reg, Register base, std::int32_t disp )
+{
+    modrm( 0b10, reg, code( base ) );
+
+    // RSP as a base can only be encoded through a SIB byte.
+    if ( base == Register::RSP )
+        byte( 0x24 );
+    int32( disp );
+}
+
+void Assembler::sse( std::uint8_t prefix, std::uint8_t opcode,
+                     std::uint8_t reg, std::uint8_t rm )
+{
+    byte( prefix );
+    byte( 0x0f );
+    byte( opcode );
+    modrm( 0b11, reg, rm );
+}
+
+void Assembler::reference( Label& label )
+{
+    if ( label.offset >= 0 )
+    {
+        int32( static_cast<std::int32_t>(
+            label.offset - static_cast<std::int64_t>( m_code.size() + 4 ) ) );
+        return;
+    }
+
+    label.uses.push_back( m_code.size() );
+    int32( 0 );
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Encodes the handful of x86-64 instructions the JIT emits into a byte
+// buffer. Only the first eight general purpose and SSE registers are
+// available, so no instruction needs REX.R or REX.B. Memory operands are
+// always a base register plus a 32-bit displacement.
+class Assembler
+{
+public:
+    enum class Register : std::uint8_t
+    {
+        RAX,
+        RCX,
+        RDX,
+        RBX,
+        RSP,
+        RBP,
+        RSI,
+        RDI
+    };
+
+    enum class Xmm : std::uint8_t
+    {
+        XMM0,
+        XMM1
+    };
+
+    // Condition codes, named for the unsigned comparisons that ucomisd
+    // sets the flags for.
+    enum class Condition : std::uint8_t
+    {
+        BELOW = 0x2,
+        ABOVE_EQUAL = 0x3,
+        EQUAL = 0x4,
+        NOT_EQUAL = 0x5,
+        BELOW_EQUAL = 0x6,
+        ABOVE = 0x7,
+        PARITY = 0xa,
+        NOT_PARITY = 0xb
+    };
+
+    // A position in the code that jumps and calls can refer to before it
+    // is bound.
+    struct Label
+    {
+        std::int64_t offset{ -1 };
+        std::vector<std::size_t> uses{};
+    };
+
+    const std::vector<std::uint8_t>& getCode() const
+    {
+        return m_code;
+    }
+
+    std::size_t size() const
+    {
+        return m_code.size();
+    }
+
+    void bind( Label& label );
+
+    // Integer instructions. Everything but setcc, movzx and the 8-bit
+    // logic operates on all 64 bits.
+    void push( Register reg );
+    void pop( Register reg );
+    void ret();
+    void mov( Register dst, Register src );
+    void mov( Register dst, std::uint64_t imm );
+    void load( Register dst, Register base, std::int32_t disp );
+    void store( Register base, std::int32_t disp, Register src );
+    void lea( Register dst, Register base, std::int32_t disp );
+    void add( Register dst, std::int32_t imm );
+    void sub( Register dst, std::int32_t imm );
+    void addToMemory( Register base, std::int32_t disp, std::int8_t imm );
+    void cmp( Register left, Register right );
+    void test( Register left, Register right );
+    void setcc( Condition condition, Register dst );
+    void movzxByte( Register dst, Register src );
+    void andByte( Register dst, Register src );
+    void orByte( Register dst, Register src );
+
+    // Returns the offset of the 32-bit immediate, so a frame size can be
+    // patched in once it is known.
+    std::size_t subWithPatch( Register dst );
+    void patch32( std::size_t offset, std::int32_t value );
+
+    // Scalar double instructions.
+    void movsd( Xmm dst, Register base, std::int32_t disp );
+    void movsd( Register base, std::int32_t disp, Xmm src );
+    void movapd( Xmm dst, Xmm src );
+    void movq( Xmm dst, Register src );
+    void movq( Register dst, Xmm src );
+    void addsd( Xmm dst, Xmm src );
+    void subsd( Xmm dst, Xmm src );
+    void mulsd( Xmm dst, Xmm src );
+    void divsd( Xmm dst, Xmm src );
+    void xorpd( Xmm dst, Xmm src );
+    void ucomisd( Xmm left, Xmm right );
+    void cvtsi2sd( Xmm dst, Register src );
+
+    // Control flow. Jumps and direct calls always use 32-bit offsets.
+    void jump( Label& label );
+    void jump( Condition condition, Label& label );
+    void call( Label& label );
+    void call( Register target );
+
+private:
+    void byte( std::uint8_t value );
+    void int32( std::int32_t value );
+    void rexW();
+    void modrm( std::uint8_t mod, std::uint8_t reg, std::uint8_t rm );
+    void memory( std::uint8_t reg, Register base, std::int32_t disp );
+    void sse( std::uint8_t prefix, std::uint8_t opcode, std::uint8_t reg,
+              std::uint8_t rm );
+    void reference( Label& label );
+
+    std::vector<std::uint8_t> m_code{};
+};
@@ -0,0 +1,61 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "Chunk.h"
+#include "Object.h"
+#include "Symbol.h"
+#include "VMObject.h"
+
+void Chunk::write( std::uint8_t byte, int line )
+{
+    if ( lines.empty() || lines.back().line != line )
+        lines.push_back( LineRun{ code.size(), line } );
+
+    code.push_back( byte );
+}
+
+void Chunk::writeShort( std::uint16_t value, int line )
+{
+    write( static_cast<std::uint8_t>( ( value >> 8 ) & 0xff ), line );
+    write( static_cast<std::uint8_t>( value & 0xff ), line );
+}
+
+std::size_t Chunk::addConstant( const Object& value )
+{
+    constants.push_back( value );
+    return constants.size() - 1;
+}
+
+std::size_t Chunk::addName( Symbol name )
+{
+    // Property and method names repeat a lot within one function.
+    auto existing = std::find( names.begin(), names.end(), name );
+    if ( existing != names.end() )
+        return static_cast<std::size_t>( existing - names.begin() );
+
+    names.push_back( name );
+    return names.size() - 1;
+}
+
+std::size_t Chunk::addFunction( std::shared_ptr<VMFunction> function )
+{
+    functions.push_back( std::move( function ) );
+    return functions.size() - 1;
+}
+
+int Chunk::getLine( std::size_t offset ) const
+{
+    // First run that starts after the offset; the one before it owns it.
+    auto run = std::upper_bound(
+        lines.begin(), lines.end(), offset,
+        []( std::size_t value, const LineRun& entry ) {
+            return value < entry.offset;
+        } );
+
+    if ( run == lines.begin() )
+        return 0;
+
+    return std::prev( run )->line;
+}
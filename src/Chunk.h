@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Object.h"
+#include "Symbol.h"
+
+struct VMFunction;
+
+namespace OpCode
+{
+    enum Code : std::uint8_t
+    {
+        // Constants and literals.
+        CONSTANT,
+        NIL,
+        TRUE,
+        FALSE,
+        POP,
+
+        // Variables.
+        GET_LOCAL,
+        SET_LOCAL,
+        GET_GLOBAL,
+        DEFINE_GLOBAL,
+        SET_GLOBAL,
+        GET_UPVALUE,
+        SET_UPVALUE,
+        GET_PROPERTY,
+        SET_PROPERTY,
+        GET_SUPER,
+
+        // Operators.
+        EQUAL,
+        NOT_EQUAL,
+        GREATER,
+        GREATER_EQUAL,
+        LESS,
+        LESS_EQUAL,
+        ADD,
+        SUBTRACT,
+        MULTIPLY,
+        DIVIDE,
+        NOT,
+        NEGATE,
+
+        // Statements and control flow.
+        PRINT,
+        JUMP,
+        JUMP_IF_FALSE,
+        LOOP,
+        CALL,
+        INVOKE,
+        SUPER_INVOKE,
+        CLOSURE,
+        CLOSE_UPVALUE,
+        RETURN,
+
+        // Classes.
+        CLASS,
+        INHERIT,
+        METHOD,
+
+        // Max enumerations.
+        MAX_OPCODE
+    };
+} // namespace OpCode
+
+// A compiled unit of bytecode. Operands are one byte for local, upvalue and
+// argument counts, and two bytes (big endian) for constant, name, global and
+// jump operands. Source lines are run-length encoded so the table stays small.
+struct Chunk
+{
+    void write( std::uint8_t byte, int line );
+    void writeShort( std::uint16_t value, int line );
+    std::size_t addConstant( const Object& value );
+    std::size_t addName( Symbol name );
+    std::size_t addFunction( std::shared_ptr<VMFunction> function );
+    int getLine( std::size_t offset ) const;
+
+    struct LineRun
+    {
+        std::size_t offset;
+        int line;
+    };
+
+    std::vector<std::uint8_t> code{};
+    std::vector<Object> constants{};
+    std::vector<Symbol> names{};
+    std::vector<std::shared_ptr<VMFunction>> functions{};
+    std::vector<LineRun> lines{};
+};
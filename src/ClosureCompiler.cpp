@@ -0,0 +1,526 @@
+#include <functional>
+#include <iostream>
+#include <utility>
+#include <variant>
+
+#include "ClosureCompiler.h"
+#include "Environment.h"
+#include "Error.h"
+#include "Expression.h"
+#include "Interpreter.h"
+#include "LoxInstance.h"
+#include "Object.h"
+#include "Statement.h"
+#include "Token.h"
+
+namespace
+{
+    // A local that holds its value directly, rather than in a cell.
+    bool isPlainLocal( const Location& location )
+    {
+        return !location.isGlobal() && !location.isUpvalue() &&
+               !location.captured;
+    }
+} // namespace
+
+std::vector<StmtCode> ClosureCompiler::compile(
+    const NodeList<Stmt*>& statements )
+{
+    std::vector<StmtCode> code{};
+    code.reserve( statements.size() );
+    for ( auto&& statement : statements )
+    {
+        code.push_back( compile( statement ) );
+    }
+    return code;
+}
+
+ExprCode ClosureCompiler::compile( Expr* expr )
+{
+    expr->accept( this );
+    return std::move( m_expr );
+}
+
+StmtCode ClosureCompiler::compile( Stmt* stmt )
+{
+    stmt->accept( this );
+    return std::move( m_stmt );
+}
+
+void ClosureCompiler::compileBody( Function* function )
+{
+    ++m_scopeDepth;
+    function->compiledBody = compile( function->body );
+    --m_scopeDepth;
+}
+
+ExprCode ClosureCompiler::load( const Token& name, Location& location )
+{
+    if ( location.isGlobal() )
+    {
+        return [&name, &location]( Interpreter& interpreter ) {
+            return interpreter.m_globals->get(
+                name, interpreter.global( name, location ) );
+        };
+    }
+
+    std::size_t slot = static_cast<std::size_t>( location.slot );
+    if ( location.isUpvalue() )
+    {
+        return [slot]( Interpreter& interpreter ) {
+            return ( *interpreter.m_upvalues )[slot]->value;
+        };
+    }
+
+    std::size_t depth = static_cast<std::size_t>( location.depth );
+    if ( location.captured )
+    {
+        return [depth, slot]( Interpreter& interpreter ) {
+            return interpreter.local( depth, slot ).as<Cell>()->value;
+        };
+    }
+
+    return [depth, slot]( Interpreter& interpreter ) {
+        return interpreter.local( depth, slot );
+    };
+}
+
+template <typename Then>
+ExprCode ClosureCompiler::operand( Expr* expr, Then then )
+{
+    if ( Literal* literal = dynamic_cast<Literal*>( expr ) )
+    {
+        return then(
+            [value = literal->value]( Interpreter& ) { return value; } );
+    }
+
+    Variable* variable = dynamic_cast<Variable*>( expr );
+    if ( variable && isPlainLocal( variable->location ) )
+    {
+        std::size_t depth =
+            static_cast<std::size_t>( variable->location.depth );
+        std::size_t slot = static_cast<std::size_t>( variable->location.slot );
+        return then( [depth, slot]( Interpreter& interpreter ) {
+            return interpreter.local( depth, slot );
+        } );
+    }
+
+    return then( [code = compile( expr )]( Interpreter& interpreter ) {
+        return code( interpreter );
+    } );
+}
+
+template <typename Op>
+ExprCode ClosureCompiler::binary( Binary* expr )
+{
+    // Operands of other types take the Interpreter's generic path, which
+    // concatenates strings, compares by value and reports errors.
+    return operand( expr->left, [&]( auto left ) {
+        return operand( expr->right, [&]( auto right ) -> ExprCode {
+            return [left, right, expr]( Interpreter& interpreter ) -> Object {
+                Object a = left( interpreter );
+                Object b = right( interpreter );
+                if ( a.isNumber() && b.isNumber() )
+                    return Op{}( a.asNumber(), b.asNumber() );
+                return interpreter.binary( expr, a, b );
+            };
+        } );
+    } );
+}
+
+template <typename Then>
+auto ClosureCompiler::call( Call* expr, Then then )
+{
+    std::vector<ExprCode> arguments{};
+    arguments.reserve( expr->arguments.size() );
+
+    if ( Get* property = expr->property )
+    {
+        ExprCode object = compile( property->object );
+        for ( auto&& argument : expr->arguments )
+        {
+            arguments.push_back( compile( argument ) );
+        }
+
+        return then( [object, arguments, expr]( Interpreter& interpreter ) {
+            Interpreter::PendingCall call{};
+            interpreter.lookUpProperty( call, expr->property,
+                                        object( interpreter ) );
+            call.arguments = interpreter.beginArguments();
+            for ( const ExprCode& argument : arguments )
+            {
+                interpreter.m_stack.push_back( argument( interpreter ) );
+            }
+
+            interpreter.checkCallee( expr, call );
+            return call;
+        } );
+    }
+
+    ExprCode callee = compile( expr->callee );
+    for ( auto&& argument : expr->arguments )
+    {
+        arguments.push_back( compile( argument ) );
+    }
+
+    return then( [callee, arguments, expr]( Interpreter& interpreter ) {
+        Interpreter::PendingCall call{};
+        call.callee = callee( interpreter );
+        call.arguments = interpreter.beginArguments();
+        for ( const ExprCode& argument : arguments )
+        {
+            interpreter.m_stack.push_back( argument( interpreter ) );
+        }
+
+        interpreter.checkCallee( expr, call );
+        return call;
+    } );
+}
+
+void ClosureCompiler::visit( Block* stmt )
+{
+    ++m_scopeDepth;
+    std::vector<StmtCode> statements = compile( stmt->statements );
+    --m_scopeDepth;
+
+    m_stmt = [statements]( Interpreter& interpreter ) {
+        return interpreter.executeBlock( statements,
+                                         interpreter.m_stack.size() );
+    };
+}
+
+void ClosureCompiler::visit( ClassStmt* stmt )
+{
+    for ( auto&& method : stmt->methods )
+    {
+        compileBody( method );
+    }
+
+    m_stmt = [stmt]( Interpreter& interpreter ) {
+        return interpreter.visit( stmt );
+    };
+}
+
+void ClosureCompiler::visit( Expression* stmt )
+{
+    m_stmt = [expression = compile( stmt->expression )](
+                 Interpreter& interpreter ) {
+        expression( interpreter );
+        return Completion::normal();
+    };
+}
+
+void ClosureCompiler::visit( Function* stmt )
+{
+    compileBody( stmt );
+
+    m_stmt = [stmt]( Interpreter& interpreter ) {
+        return interpreter.visit( stmt );
+    };
+}
+
+void ClosureCompiler::visit( If* stmt )
+{
+    ExprCode condition = compile( stmt->condition );
+    StmtCode thenBranch = compile( stmt->thenBranch );
+
+    if ( !stmt->elseBranch )
+    {
+        m_stmt = [condition, thenBranch]( Interpreter& interpreter ) {
+            if ( interpreter.isTruthy( condition( interpreter ) ) )
+                return thenBranch( interpreter );
+            return Completion::normal();
+        };
+        return;
+    }
+
+    StmtCode elseBranch = compile( stmt->elseBranch );
+    m_stmt = [condition, thenBranch, elseBranch]( Interpreter& interpreter ) {
+        if ( interpreter.isTruthy( condition( interpreter ) ) )
+            return thenBranch( interpreter );
+        return elseBranch( interpreter );
+    };
+}
+
+void ClosureCompiler::visit( Print* stmt )
+{
+    m_stmt = [expression = compile( stmt->expression )](
+                 Interpreter& interpreter ) {
+        printObject( std::cout, expression( interpreter ) );
+        std::cout << '\n';
+        return Completion::normal();
+    };
+}
+
+void ClosureCompiler::visit( Return* stmt )
+{
+    if ( stmt->tailCall )
+    {
+        m_stmt = call( stmt->tailCall, []( auto pending ) -> StmtCode {
+            return [pending]( Interpreter& interpreter ) {
+                interpreter.setTailCall( pending( interpreter ) );
+                return Completion::tailCall();
+            };
+        } );
+        return;
+    }
+
+    if ( !stmt->value )
+    {
+        m_stmt = []( Interpreter& ) {
+            return Completion::returning( Object{ std::monostate{} } );
+        };
+        return;
+    }
+
+    m_stmt = [value = compile( stmt->value )]( Interpreter& interpreter ) {
+        return Completion::returning( value( interpreter ) );
+    };
+}
+
+void ClosureCompiler::visit( Var* stmt )
+{
+    ExprCode initializer =
+        stmt->initializer ? compile( stmt->initializer )
+                          : ExprCode{ []( Interpreter& ) {
+                                return Object{ std::monostate{} };
+                            } };
+
+    if ( m_scopeDepth == 0 )
+    {
+        m_stmt = [initializer, stmt]( Interpreter& interpreter ) {
+            interpreter.m_globals->define( stmt->name.getSymbol(),
+                                           initializer( interpreter ) );
+            return Completion::normal();
+        };
+    }
+    else if ( stmt->captured )
+    {
+        m_stmt = [initializer]( Interpreter& interpreter ) {
+            interpreter.m_stack.push_back(
+                makeRef<Cell>( initializer( interpreter ) ) );
+            return Completion::normal();
+        };
+    }
+    else
+    {
+        m_stmt = [initializer]( Interpreter& interpreter ) {
+            interpreter.m_stack.push_back( initializer( interpreter ) );
+            return Completion::normal();
+        };
+    }
+}
+
+void ClosureCompiler::visit( While* stmt )
+{
+    m_stmt = [condition = compile( stmt->condition ),
+              body = compile( stmt->body )]( Interpreter& interpreter ) {
+        while ( interpreter.isTruthy( condition( interpreter ) ) )
+        {
+            Completion completion = body( interpreter );
+            if ( completion.isReturn() )
+                return completion;
+        }
+
+        return Completion::normal();
+    };
+}
+
+void ClosureCompiler::visit( Assign* expr )
+{
+    ExprCode value = compile( expr->value );
+    const Location& location = expr->location;
+
+    if ( location.isGlobal() )
+    {
+        m_expr = [value, expr]( Interpreter& interpreter ) {
+            Object result = value( interpreter );
+            interpreter.m_globals->assign(
+                expr->name, interpreter.global( expr->name, expr->location ),
+                result );
+            return result;
+        };
+        return;
+    }
+
+    std::size_t slot = static_cast<std::size_t>( location.slot );
+    if ( location.isUpvalue() )
+    {
+        m_expr = [value, slot]( Interpreter& interpreter ) {
+            Object result = value( interpreter );
+            ( *interpreter.m_upvalues )[slot]->value = result;
+            return result;
+        };
+        return;
+    }
+
+    std::size_t depth = static_cast<std::size_t>( location.depth );
+    if ( location.captured )
+    {
+        m_expr = [value, depth, slot]( Interpreter& interpreter ) {
+            Object result = value( interpreter );
+            interpreter.local( depth, slot ).as<Cell>()->value = result;
+            return result;
+        };
+        return;
+    }
+
+    m_expr = [value, depth, slot]( Interpreter& interpreter ) {
+        Object result = value( interpreter );
+        interpreter.local( depth, slot ) = result;
+        return result;
+    };
+}
+
+void ClosureCompiler::visit( Binary* expr )
+{
+    switch ( expr->op.getType() )
+    {
+    case TokenType::PLUS:
+        m_expr = binary<std::plus<>>( expr );
+        break;
+    case TokenType::MINUS:
+        m_expr = binary<std::minus<>>( expr );
+        break;
+    case TokenType::STAR:
+        m_expr = binary<std::multiplies<>>( expr );
+        break;
+    case TokenType::SLASH:
+        m_expr = binary<std::divides<>>( expr );
+        break;
+    case TokenType::GREATER:
+        m_expr = binary<std::greater<>>( expr );
+        break;
+    case TokenType::GREATER_EQUAL:
+        m_expr = binary<std::greater_equal<>>( expr );
+        break;
+    case TokenType::LESS:
+        m_expr = binary<std::less<>>( expr );
+        break;
+    case TokenType::LESS_EQUAL:
+        m_expr = binary<std::less_equal<>>( expr );
+        break;
+    case TokenType::EQUAL_EQUAL:
+        m_expr = binary<std::equal_to<>>( expr );
+        break;
+    case TokenType::BANG_EQUAL:
+        m_expr = binary<std::not_equal_to<>>( expr );
+        break;
+    default:
+        m_expr = []( Interpreter& ) { return Object{ std::monostate{} }; };
+        break;
+    }
+}
+
+void ClosureCompiler::visit( Call* expr )
+{
+    m_expr = call( expr, []( auto pending ) -> ExprCode {
+        return [pending]( Interpreter& interpreter ) {
+            Interpreter::PendingCall call = pending( interpreter );
+            return interpreter.makeCall( call );
+        };
+    } );
+}
+
+void ClosureCompiler::visit( Get* expr )
+{
+    m_expr = [object = compile( expr->object ),
+              expr]( Interpreter& interpreter ) {
+        Object value = object( interpreter );
+        if ( !value.isInstance() )
+        {
+            throw Error::RuntimeError{ expr->name,
+                                       "Only instances have properties." };
+        }
+
+        return value.as<LoxInstance>()->get( expr->name, expr->cache );
+    };
+}
+
+void ClosureCompiler::visit( Grouping* expr )
+{
+    m_expr = compile( expr->expr );
+}
+
+void ClosureCompiler::visit( Literal* expr )
+{
+    m_expr = [value = expr->value]( Interpreter& ) { return value; };
+}
+
+void ClosureCompiler::visit( Logical* expr )
+{
+    ExprCode left = compile( expr->left );
+    ExprCode right = compile( expr->right );
+
+    if ( expr->op.getType() == TokenType::OR )
+    {
+        m_expr = [left, right]( Interpreter& interpreter ) {
+            Object value = left( interpreter );
+            if ( interpreter.isTruthy( value ) )
+                return value;
+            return right( interpreter );
+        };
+        return;
+    }
+
+    m_expr = [left, right]( Interpreter& interpreter ) {
+        Object value = left( interpreter );
+        if ( !interpreter.isTruthy( value ) )
+            return value;
+        return right( interpreter );
+    };
+}
+
+void ClosureCompiler::visit( Set* expr )
+{
+    m_expr = [object = compile( expr->object ), value = compile( expr->value ),
+              expr]( Interpreter& interpreter ) {
+        Object instance = object( interpreter );
+        if ( !instance.isInstance() )
+        {
+            throw Error::RuntimeError{ expr->name,
+                                       "Only instances have fields." };
+        }
+
+        Object result = value( interpreter );
+        instance.as<LoxInstance>()->set( expr->name, result, expr->cache );
+        return result;
+    };
+}
+
+void ClosureCompiler::visit( Super* expr )
+{
+    // Only reads variables, so it has nothing to specialize.
+    m_expr = [expr]( Interpreter& interpreter ) {
+        return interpreter.visit( expr );
+    };
+}
+
+void ClosureCompiler::visit( This* expr )
+{
+    m_expr = load( expr->keyword, expr->location );
+}
+
+void ClosureCompiler::visit( Unary* expr )
+{
+    ExprCode right = compile( expr->right );
+
+    if ( expr->op.getType() == TokenType::BANG )
+    {
+        m_expr = [right]( Interpreter& interpreter ) -> Object {
+            return !interpreter.isTruthy( right( interpreter ) );
+        };
+        return;
+    }
+
+    m_expr = [right, expr]( Interpreter& interpreter ) -> Object {
+        Object value = right( interpreter );
+        interpreter.checkNumberOperand( expr->op, value );
+        return -value.asNumber();
+    };
+}
+
+void ClosureCompiler::visit( Variable* expr )
+{
+    m_expr = load( expr->name, expr->location );
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "Arena.h"
+#include "Completion.h"
+#include "Object.h"
+#include "Token.h"
+#include "Visitor.h"
+
+class Interpreter;
+struct Expr;
+struct Location;
+struct Stmt;
+
+// Code for one node, as produced by the ClosureCompiler.
+using ExprCode = std::function<Object( Interpreter& )>;
+using StmtCode = std::function<Completion( Interpreter& )>;
+
+// Turns a resolved program into a tree of closures for the Interpreter to
+// run, in one walk over the AST. Each closure has everything the visitor
+// would look up at runtime baked in: the operator of a Binary node, the
+// scope and slot of a local, whether a declaration is global, the value of
+// a literal. Binary nodes are instantiated per operator and per shape of
+// their operands, so "i < 10" reads a slot and compares it against a
+// constant without calling out to either child.
+//
+// The closures run on the same frame stack and the same runtime objects as
+// the tree-walker. Function bodies are stored in their declaration for
+// LoxFunction to run, and class declarations, which run rarely, are left to
+// the tree-walker.
+class ClosureCompiler : public IVisitor
+{
+public:
+    std::vector<StmtCode> compile( const NodeList<Stmt*>& statements );
+
+    void visit( Block* stmt ) override;
+    void visit( ClassStmt* stmt ) override;
+    void visit( Expression* stmt ) override;
+    void visit( Function* stmt ) override;
+    void visit( If* stmt ) override;
+    void visit( Print* stmt ) override;
+    void visit( Return* stmt ) override;
+    void visit( Var* stmt ) override;
+    void visit( While* stmt ) override;
+
+    void visit( Assign* expr ) override;
+    void visit( Binary* expr ) override;
+    void visit( Call* expr ) override;
+    void visit( Get* expr ) override;
+    void visit( Grouping* expr ) override;
+    void visit( Literal* expr ) override;
+    void visit( Logical* expr ) override;
+    void visit( Set* expr ) override;
+    void visit( Super* expr ) override;
+    void visit( This* expr ) override;
+    void visit( Unary* expr ) override;
+    void visit( Variable* expr ) override;
+
+private:
+    ExprCode compile( Expr* expr );
+    StmtCode compile( Stmt* stmt );
+    void compileBody( Function* function );
+
+    // Code that reads the variable at 'location'.
+    ExprCode load( const Token& name, Location& location );
+
+    template <typename Op>
+    ExprCode binary( Binary* expr );
+
+    // Passes 'then' a callable that evaluates 'expr', specialized for a
+    // literal or a local that needs no cell.
+    template <typename Then>
+    ExprCode operand( Expr* expr, Then then );
+
+    // Passes 'then' a callable that evaluates the callee and arguments of
+    // 'expr' into an Interpreter::PendingCall, for a call or a tail call to
+    // build on.
+    template <typename Then>
+    auto call( Call* expr, Then then );
+
+    ExprCode m_expr{};
+    StmtCode m_stmt{};
+
+    // Blocks and function bodies the walk is inside of. Declarations
+    // outside all of them are globals.
+    std::size_t m_scopeDepth{ 0 };
+};
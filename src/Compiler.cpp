@@ -0,0 +1,672 @@
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "Chunk.h"
+#include "Compiler.h"
+#include "Error.h"
+#include "Expression.h"
+#include "Object.h"
+#include "Statement.h"
+#include "Token.h"
+#include "VMObject.h"
+
+namespace
+{
+    constexpr std::size_t MAX_SLOTS = 256;
+    constexpr std::size_t MAX_OPERAND =
+        std::numeric_limits<std::uint16_t>::max();
+} // namespace
+
+std::shared_ptr<VMFunction> Compiler::compile(
+    const NodeList<Stmt*>& statements )
+{
+    FunctionState script{};
+    beginFunction( script, FunctionType::SCRIPT, "script" );
+
+    compileBlock( statements );
+
+    return endFunction();
+}
+
+void Compiler::visit( Assign* expr )
+{
+    compile( expr->value );
+    m_line = expr->name.getLine();
+    setVariable( expr->name );
+}
+
+void Compiler::visit( Binary* expr )
+{
+    compile( expr->left );
+    compile( expr->right );
+
+    m_line = expr->op.getLine();
+    switch ( expr->op.getType() )
+    {
+    case TokenType::GREATER:
+        emit( OpCode::GREATER );
+        break;
+    case TokenType::GREATER_EQUAL:
+        emit( OpCode::GREATER_EQUAL );
+        break;
+    case TokenType::LESS:
+        emit( OpCode::LESS );
+        break;
+    case TokenType::LESS_EQUAL:
+        emit( OpCode::LESS_EQUAL );
+        break;
+    case TokenType::BANG_EQUAL:
+        emit( OpCode::NOT_EQUAL );
+        break;
+    case TokenType::EQUAL_EQUAL:
+        emit( OpCode::EQUAL );
+        break;
+    case TokenType::MINUS:
+        emit( OpCode::SUBTRACT );
+        break;
+    case TokenType::PLUS:
+        emit( OpCode::ADD );
+        break;
+    case TokenType::SLASH:
+        emit( OpCode::DIVIDE );
+        break;
+    case TokenType::STAR:
+        emit( OpCode::MULTIPLY );
+        break;
+    default:
+        emit( OpCode::POP );
+        emit( OpCode::POP );
+        emit( OpCode::NIL );
+        break;
+    }
+}
+
+void Compiler::visit( Call* expr )
+{
+    std::uint8_t argCount = static_cast<std::uint8_t>( expr->arguments.size() );
+
+    // obj.method( args ) and super.method( args ) skip creating a bound
+    // method for the callee.
+    if ( Get* get = dynamic_cast<Get*>( expr->callee ) )
+    {
+        compile( get->object );
+        for ( auto&& argument : expr->arguments )
+            compile( argument );
+
+        m_line = expr->paren.getLine();
+        emitShort( OpCode::INVOKE, identifierName( get->name ) );
+        emit( argCount );
+        return;
+    }
+
+    if ( Super* super = dynamic_cast<Super*>( expr->callee ) )
+    {
+        m_line = super->keyword.getLine();
+        getVariable( Token{ TokenType::THIS, "this", Object{ std::monostate{} },
+                            m_line } );
+        for ( auto&& argument : expr->arguments )
+            compile( argument );
+
+        m_line = super->keyword.getLine();
+        getVariable( super->keyword );
+        m_line = expr->paren.getLine();
+        emitShort( OpCode::SUPER_INVOKE, identifierName( super->method ) );
+        emit( argCount );
+        return;
+    }
+
+    compile( expr->callee );
+    for ( auto&& argument : expr->arguments )
+        compile( argument );
+
+    m_line = expr->paren.getLine();
+    emit( OpCode::CALL, argCount );
+}
+
+void Compiler::visit( Get* expr )
+{
+    compile( expr->object );
+    m_line = expr->name.getLine();
+    emitShort( OpCode::GET_PROPERTY, identifierName( expr->name ) );
+}
+
+void Compiler::visit( Grouping* expr )
+{
+    compile( expr->expr );
+}
+
+void Compiler::visit( Literal* expr )
+{
+    if ( expr->value.isNil() )
+        emit( OpCode::NIL );
+    else if ( expr->value.isBool() )
+        emit( expr->value.asBool() ? OpCode::TRUE : OpCode::FALSE );
+    else
+        emitShort( OpCode::CONSTANT, makeConstant( expr->value ) );
+}
+
+void Compiler::visit( Logical* expr )
+{
+    compile( expr->left );
+    m_line = expr->op.getLine();
+
+    if ( expr->op.getType() == TokenType::OR )
+    {
+        std::size_t elseJump = emitJump( OpCode::JUMP_IF_FALSE );
+        std::size_t endJump = emitJump( OpCode::JUMP );
+
+        patchJump( elseJump );
+        emit( OpCode::POP );
+
+        compile( expr->right );
+        patchJump( endJump );
+    }
+    else
+    {
+        std::size_t endJump = emitJump( OpCode::JUMP_IF_FALSE );
+
+        emit( OpCode::POP );
+        compile( expr->right );
+
+        patchJump( endJump );
+    }
+}
+
+void Compiler::visit( Set* expr )
+{
+    compile( expr->object );
+    compile( expr->value );
+    m_line = expr->name.getLine();
+    emitShort( OpCode::SET_PROPERTY, identifierName( expr->name ) );
+}
+
+void Compiler::visit( Super* expr )
+{
+    m_line = expr->keyword.getLine();
+    getVariable(
+        Token{ TokenType::THIS, "this", Object{ std::monostate{} }, m_line } );
+    getVariable( expr->keyword );
+
+    m_line = expr->method.getLine();
+    emitShort( OpCode::GET_SUPER, identifierName( expr->method ) );
+}
+
+void Compiler::visit( This* expr )
+{
+    m_line = expr->keyword.getLine();
+    getVariable( expr->keyword );
+}
+
+void Compiler::visit( Unary* expr )
+{
+    compile( expr->right );
+
+    m_line = expr->op.getLine();
+    switch ( expr->op.getType() )
+    {
+    case TokenType::BANG:
+        emit( OpCode::NOT );
+        break;
+    case TokenType::MINUS:
+        emit( OpCode::NEGATE );
+        break;
+    default:
+        emit( OpCode::POP );
+        emit( OpCode::NIL );
+        break;
+    }
+}
+
+void Compiler::visit( Variable* expr )
+{
+    m_line = expr->name.getLine();
+    getVariable( expr->name );
+}
+
+void Compiler::visit( Block* stmt )
+{
+    beginScope();
+    compileBlock( stmt->statements );
+    endScope();
+}
+
+void Compiler::visit( ClassStmt* stmt )
+{
+    m_line = stmt->name.getLine();
+    std::uint16_t nameOperand = identifierName( stmt->name );
+    declareLocal( stmt->name );
+
+    emitShort( OpCode::CLASS, nameOperand );
+    defineVariable( stmt->name );
+
+    ClassState classState{ m_currentClass, false };
+    m_currentClass = &classState;
+
+    if ( stmt->superclass )
+    {
+        compile( stmt->superclass );
+
+        // The superclass stays on the stack as a hidden "super" local that
+        // methods capture as an upvalue.
+        beginScope();
+        declareLocal( Token{ TokenType::SUPER, "super",
+                             Object{ std::monostate{} }, m_line } );
+
+        getVariable( stmt->name );
+        m_line = stmt->superclass->name.getLine();
+        emit( OpCode::INHERIT );
+        classState.hasSuperclass = true;
+    }
+
+    getVariable( stmt->name );
+    for ( auto&& method : stmt->methods )
+    {
+        FunctionType type = FunctionType::METHOD;
+        if ( method->name.getSymbol() == Symbols::INIT )
+            type = FunctionType::INITIALIZER;
+
+        compileFunction( method, type );
+        m_line = method->name.getLine();
+        emitShort( OpCode::METHOD, identifierName( method->name ) );
+    }
+    emit( OpCode::POP );
+
+    if ( classState.hasSuperclass )
+        endScope();
+
+    m_currentClass = classState.enclosing;
+}
+
+void Compiler::visit( Expression* stmt )
+{
+    compile( stmt->expression );
+    emit( OpCode::POP );
+}
+
+void Compiler::visit( Function* stmt )
+{
+    m_line = stmt->name.getLine();
+    // Declared before the body is compiled so the function can refer to
+    // itself recursively.
+    declareLocal( stmt->name );
+    compileFunction( stmt, FunctionType::FUNCTION );
+    defineVariable( stmt->name );
+}
+
+void Compiler::visit( If* stmt )
+{
+    compile( stmt->condition );
+
+    std::size_t thenJump = emitJump( OpCode::JUMP_IF_FALSE );
+    emit( OpCode::POP );
+    compile( stmt->thenBranch );
+
+    std::size_t elseJump = emitJump( OpCode::JUMP );
+    patchJump( thenJump );
+    emit( OpCode::POP );
+
+    if ( stmt->elseBranch )
+        compile( stmt->elseBranch );
+
+    patchJump( elseJump );
+}
+
+void Compiler::visit( Print* stmt )
+{
+    compile( stmt->expression );
+    emit( OpCode::PRINT );
+}
+
+void Compiler::visit( Return* stmt )
+{
+    m_line = stmt->keyword.getLine();
+    if ( !stmt->value )
+    {
+        emitReturn();
+        return;
+    }
+
+    compile( stmt->value );
+    emit( OpCode::RETURN );
+}
+
+void Compiler::visit( Var* stmt )
+{
+    m_line = stmt->name.getLine();
+
+    if ( stmt->initializer )
+        compile( stmt->initializer );
+    else
+        emit( OpCode::NIL );
+
+    declareLocal( stmt->name );
+    defineVariable( stmt->name );
+}
+
+void Compiler::visit( While* stmt )
+{
+    std::size_t loopStart = currentChunk().code.size();
+    compile( stmt->condition );
+
+    std::size_t exitJump = emitJump( OpCode::JUMP_IF_FALSE );
+    emit( OpCode::POP );
+    compile( stmt->body );
+    emitLoop( loopStart );
+
+    patchJump( exitJump );
+    emit( OpCode::POP );
+}
+
+void Compiler::compile( Stmt* stmt )
+{
+    stmt->accept( this );
+}
+
+void Compiler::compile( Expr* expr )
+{
+    expr->accept( this );
+}
+
+void Compiler::compileBlock( const NodeList<Stmt*>& statements )
+{
+    for ( auto&& statement : statements )
+    {
+        compile( statement );
+    }
+}
+
+void Compiler::compileFunction( Function* function, FunctionType type )
+{
+    FunctionState state{};
+    beginFunction( state, type, function->name.getLexeme() );
+    beginScope();
+
+    m_current->function->arity = static_cast<int>( function->params.size() );
+    for ( const auto& param : function->params )
+    {
+        declareLocal( param );
+        defineVariable( param );
+    }
+
+    compileBlock( function->body );
+
+    std::vector<Upvalue> upvalues = state.upvalues;
+    std::shared_ptr<VMFunction> compiled = endFunction();
+
+    m_line = function->name.getLine();
+    emitShort( OpCode::CLOSURE,
+               static_cast<std::uint16_t>(
+                   currentChunk().addFunction( std::move( compiled ) ) ) );
+
+    for ( const auto& upvalue : upvalues )
+    {
+        emit( upvalue.isLocal ? 1 : 0 );
+        emit( upvalue.index );
+    }
+}
+
+void Compiler::beginFunction( FunctionState& state, FunctionType type,
+                              const std::string& name )
+{
+    state.enclosing = m_current;
+    state.function = std::make_shared<VMFunction>();
+    state.function->name = name;
+    state.type = type;
+    state.scopeDepth = 0;
+    state.reportedTooManyLocals = false;
+
+    // Slot zero holds the callee, or the receiver inside methods.
+    Symbol slotZero{};
+    if ( type == FunctionType::METHOD || type == FunctionType::INITIALIZER )
+        slotZero = Symbols::THIS;
+    state.locals.push_back( Local{ slotZero, 0, false } );
+
+    m_current = &state;
+}
+
+std::shared_ptr<VMFunction> Compiler::endFunction()
+{
+    emitReturn();
+
+    std::shared_ptr<VMFunction> function = m_current->function;
+    function->upvalueCount = static_cast<int>( m_current->upvalues.size() );
+    m_current = m_current->enclosing;
+    return function;
+}
+
+Chunk& Compiler::currentChunk()
+{
+    return m_current->function->chunk;
+}
+
+void Compiler::emit( std::uint8_t byte )
+{
+    currentChunk().write( byte, m_line );
+}
+
+void Compiler::emit( std::uint8_t op, std::uint8_t operand )
+{
+    emit( op );
+    emit( operand );
+}
+
+void Compiler::emitShort( std::uint8_t op, std::uint16_t operand )
+{
+    emit( op );
+    currentChunk().writeShort( operand, m_line );
+}
+
+std::size_t Compiler::emitJump( std::uint8_t op )
+{
+    emitShort( op, 0xffff );
+    return currentChunk().code.size() - 2;
+}
+
+void Compiler::patchJump( std::size_t offset )
+{
+    // -2 to adjust for the jump offset itself.
+    std::size_t jump = currentChunk().code.size() - offset - 2;
+    if ( jump > MAX_OPERAND )
+        Error::error( m_line, "Too much code to jump over." );
+
+    currentChunk().code[offset] =
+        static_cast<std::uint8_t>( ( jump >> 8 ) & 0xff );
+    currentChunk().code[offset + 1] = static_cast<std::uint8_t>( jump & 0xff );
+}
+
+void Compiler::emitLoop( std::size_t loopStart )
+{
+    // +3 to step back over the LOOP instruction and its operand.
+    std::size_t offset = currentChunk().code.size() - loopStart + 3;
+    if ( offset > MAX_OPERAND )
+        Error::error( m_line, "Loop body too large." );
+
+    emitShort( OpCode::LOOP, static_cast<std::uint16_t>( offset ) );
+}
+
+void Compiler::emitReturn()
+{
+    if ( m_current->type == FunctionType::INITIALIZER )
+        emit( OpCode::GET_LOCAL, 0 );
+    else
+        emit( OpCode::NIL );
+
+    emit( OpCode::RETURN );
+}
+
+std::uint16_t Compiler::makeConstant( const Object& value )
+{
+    std::size_t constant = currentChunk().addConstant( value );
+    if ( constant > MAX_OPERAND )
+    {
+        Error::error( m_line, "Too many constants in one chunk." );
+        return 0;
+    }
+
+    return static_cast<std::uint16_t>( constant );
+}
+
+std::uint16_t Compiler::identifierName( const Token& name )
+{
+    std::size_t index = currentChunk().addName( name.getSymbol() );
+    if ( index > MAX_OPERAND )
+    {
+        Error::error( m_line, "Too many names in one chunk." );
+        return 0;
+    }
+
+    return static_cast<std::uint16_t>( index );
+}
+
+void Compiler::beginScope()
+{
+    m_current->scopeDepth++;
+}
+
+void Compiler::endScope()
+{
+    m_current->scopeDepth--;
+
+    std::vector<Local>& locals = m_current->locals;
+    while ( !locals.empty() && locals.back().depth > m_current->scopeDepth )
+    {
+        if ( locals.back().isCaptured )
+            emit( OpCode::CLOSE_UPVALUE );
+        else
+            emit( OpCode::POP );
+
+        locals.pop_back();
+    }
+}
+
+void Compiler::declareLocal( const Token& name )
+{
+    if ( m_current->scopeDepth == 0 )
+        return;
+
+    if ( m_current->locals.size() == MAX_SLOTS )
+    {
+        if ( !m_current->reportedTooManyLocals )
+            Error::error( name, "Too many local variables in function." );
+        m_current->reportedTooManyLocals = true;
+        return;
+    }
+
+    m_current->locals.push_back(
+        Local{ name.getSymbol(), m_current->scopeDepth, false } );
+}
+
+void Compiler::defineVariable( const Token& name )
+{
+    // Locals are already sitting in their stack slot.
+    if ( m_current->scopeDepth > 0 )
+        return;
+
+    std::size_t global = m_globals.indexOf( name.getSymbol() );
+    if ( global > MAX_OPERAND )
+    {
+        Error::error( name, "Too many global variables." );
+        return;
+    }
+
+    emitShort( OpCode::DEFINE_GLOBAL, static_cast<std::uint16_t>( global ) );
+}
+
+void Compiler::getVariable( const Token& name )
+{
+    int slot = resolveLocal( m_current, name.getSymbol() );
+    if ( slot != -1 )
+    {
+        emit( OpCode::GET_LOCAL, static_cast<std::uint8_t>( slot ) );
+        return;
+    }
+
+    slot = resolveUpvalue( m_current, name.getSymbol() );
+    if ( slot != -1 )
+    {
+        emit( OpCode::GET_UPVALUE, static_cast<std::uint8_t>( slot ) );
+        return;
+    }
+
+    std::size_t global = m_globals.indexOf( name.getSymbol() );
+    if ( global > MAX_OPERAND )
+        Error::error( name, "Too many global variables." );
+    emitShort( OpCode::GET_GLOBAL, static_cast<std::uint16_t>( global ) );
+}
+
+void Compiler::setVariable( const Token& name )
+{
+    int slot = resolveLocal( m_current, name.getSymbol() );
+    if ( slot != -1 )
+    {
+        emit( OpCode::SET_LOCAL, static_cast<std::uint8_t>( slot ) );
+        return;
+    }
+
+    slot = resolveUpvalue( m_current, name.getSymbol() );
+    if ( slot != -1 )
+    {
+        emit( OpCode::SET_UPVALUE, static_cast<std::uint8_t>( slot ) );
+        return;
+    }
+
+    std::size_t global = m_globals.indexOf( name.getSymbol() );
+    if ( global > MAX_OPERAND )
+        Error::error( name, "Too many global variables." );
+    emitShort( OpCode::SET_GLOBAL, static_cast<std::uint16_t>( global ) );
+}
+
+int Compiler::resolveLocal( FunctionState* state, Symbol name )
+{
+    for ( int i = static_cast<int>( state->locals.size() ) - 1; i >= 0; --i )
+    {
+        if ( state->locals[i].name == name )
+            return i;
+    }
+
+    return -1;
+}
+
+int Compiler::resolveUpvalue( FunctionState* state, Symbol name )
+{
+    if ( !state->enclosing )
+        return -1;
+
+    int local = resolveLocal( state->enclosing, name );
+    if ( local != -1 )
+    {
+        state->enclosing->locals[local].isCaptured = true;
+        return addUpvalue( state, static_cast<std::uint8_t>( local ), true );
+    }
+
+    int upvalue = resolveUpvalue( state->enclosing, name );
+    if ( upvalue != -1 )
+        return addUpvalue( state, static_cast<std::uint8_t>( upvalue ),
+                           false );
+
+    return -1;
+}
+
+int Compiler::addUpvalue( FunctionState* state, std::uint8_t index,
+                          bool isLocal )
+{
+    for ( std::size_t i = 0; i < state->upvalues.size(); ++i )
+    {
+        const Upvalue& upvalue = state->upvalues[i];
+        if ( upvalue.index == index && upvalue.isLocal == isLocal )
+            return static_cast<int>( i );
+    }
+
+    if ( state->upvalues.size() == MAX_SLOTS )
+    {
+        Error::error( m_line, "Too many closure variables in function." );
+        return 0;
+    }
+
+    state->upvalues.push_back( Upvalue{ index, isLocal } );
+    return static_cast<int>( state->upvalues.size() - 1 );
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Chunk.h"
+#include "Expression.h"
+#include "GlobalTable.h"
+#include "Object.h"
+#include "Statement.h"
+#include "Symbol.h"
+#include "Token.h"
+#include "VMObject.h"
+#include "Visitor.h"
+
+// Translates a resolved AST into bytecode for the VM. Locals live in stack
+// slots and captured variables become upvalues, so the Resolver's
+// environment depths are only used for its static checks.
+class Compiler : public IVisitor
+{
+public:
+    Compiler( GlobalTable& globals ) : m_globals{ globals }
+    {
+    }
+
+    std::shared_ptr<VMFunction> compile( const NodeList<Stmt*>& statements );
+
+    void visit( Assign* expr ) override;
+    void visit( Binary* expr ) override;
+    void visit( Call* expr ) override;
+    void visit( Get* expr ) override;
+    void visit( Grouping* expr ) override;
+    void visit( Literal* expr ) override;
+    void visit( Logical* expr ) override;
+    void visit( Set* expr ) override;
+    void visit( Super* expr ) override;
+    void visit( This* expr ) override;
+    void visit( Unary* expr ) override;
+    void visit( Variable* expr ) override;
+
+    void visit( Block* stmt ) override;
+    void visit( ClassStmt* stmt ) override;
+    void visit( Expression* stmt ) override;
+    void visit( Function* stmt ) override;
+    void visit( If* stmt ) override;
+    void visit( Print* stmt ) override;
+    void visit( Return* stmt ) override;
+    void visit( Var* stmt ) override;
+    void visit( While* stmt ) override;
+
+private:
+    enum class FunctionType
+    {
+        SCRIPT,
+        FUNCTION,
+        INITIALIZER,
+        METHOD
+    };
+
+    struct Local
+    {
+        Symbol name;
+        int depth;
+        bool isCaptured;
+    };
+
+    struct Upvalue
+    {
+        std::uint8_t index;
+        bool isLocal;
+    };
+
+    struct FunctionState
+    {
+        FunctionState* enclosing;
+        std::shared_ptr<VMFunction> function;
+        FunctionType type;
+        std::vector<Local> locals;
+        std::vector<Upvalue> upvalues;
+        int scopeDepth;
+
+        // The local limit has been reported, so later locals past it are
+        // dropped quietly.
+        bool reportedTooManyLocals;
+    };
+
+    struct ClassState
+    {
+        ClassState* enclosing;
+        bool hasSuperclass;
+    };
+
+    void compile( Stmt* stmt );
+    void compile( Expr* expr );
+    void compileBlock( const NodeList<Stmt*>& statements );
+    void compileFunction( Function* function, FunctionType type );
+    void beginFunction( FunctionState& state, FunctionType type,
+                        const std::string& name );
+    std::shared_ptr<VMFunction> endFunction();
+    Chunk& currentChunk();
+
+    void emit( std::uint8_t byte );
+    void emit( std::uint8_t op, std::uint8_t operand );
+    void emitShort( std::uint8_t op, std::uint16_t operand );
+    std::size_t emitJump( std::uint8_t op );
+    void patchJump( std::size_t offset );
+    void emitLoop( std::size_t loopStart );
+    void emitReturn();
+    std::uint16_t makeConstant( const Object& value );
+    std::uint16_t identifierName( const Token& name );
+
+    void beginScope();
+    void endScope();
+    void declareLocal( const Token& name );
+    void defineVariable( const Token& name );
+    void getVariable( const Token& name );
+    void setVariable( const Token& name );
+    int resolveLocal( FunctionState* state, Symbol name );
+    int resolveUpvalue( FunctionState* state, Symbol name );
+    int addUpvalue( FunctionState* state, std::uint8_t index, bool isLocal );
+
+    GlobalTable& m_globals;
+    FunctionState* m_current{ nullptr };
+    ClassState* m_currentClass{ nullptr };
+    int m_line{ 0 };
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include <utility>
+
+#include "Object.h"
+
+// How a statement finished. A return statement completes abruptly with its
+// value, and every enclosing statement passes that on until the function
+// call that owns it, so returning never unwinds the C++ stack.
+//
+// A return of a call in tail position completes with TAIL_CALL instead,
+// leaving the evaluated call with the Interpreter for the function that
+// owns the return to make in its place.
+struct Completion
+{
+    enum class Type
+    {
+        NORMAL,
+        RETURN,
+        TAIL_CALL
+    };
+
+    static Completion normal()
+    {
+        return Completion{ Type::NORMAL, Object{} };
+    }
+
+    static Completion returning( Object value )
+    {
+        return Completion{ Type::RETURN, std::move( value ) };
+    }
+
+    static Completion tailCall()
+    {
+        return Completion{ Type::TAIL_CALL, Object{} };
+    }
+
+    // True for both kinds of return, which end the function the same way.
+    bool isReturn() const
+    {
+        return type != Type::NORMAL;
+    }
+
+    bool isTailCall() const
+    {
+        return type == Type::TAIL_CALL;
+    }
+
+    Type type;
+    Object value;
+};
\ No newline at end of file
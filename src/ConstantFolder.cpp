@@ -0,0 +1,691 @@
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "ConstantFolder.h"
+#include "Expression.h"
+#include "Statement.h"
+#include "Symbol.h"
+#include "Token.h"
+
+namespace
+{
+    // Finds the scope a resolved local is declared in, as an index into the
+    // open scopes, and its slot there. An upvalue is followed out through
+    // the captures of the functions being visited, which are located from
+    // where each function is declared.
+    template <typename FunctionScope>
+    std::pair<std::size_t, std::size_t>
+    findLocal( Location location, const std::vector<FunctionScope>& functions,
+               std::size_t scopeCount )
+    {
+        std::size_t function = functions.size();
+        while ( location.isUpvalue() )
+        {
+            const FunctionScope& scope = functions[--function];
+            location =
+                scope.function
+                    ->captures[static_cast<std::size_t>( location.slot )];
+            scopeCount = scope.firstScope;
+        }
+
+        return { scopeCount - 1 - static_cast<std::size_t>( location.depth ),
+                 static_cast<std::size_t>( location.slot ) };
+    }
+
+    // Finds the variables that are assigned after their declaration. Scopes
+    // are mirrored slot for slot from the Resolver, so each assignment's
+    // Location leads straight to its declaration.
+    class AssignmentAnalysis : public IVisitor
+    {
+    public:
+        explicit AssignmentAnalysis( std::unordered_set<Var*>& reassigned )
+            : m_reassigned{ reassigned }
+        {
+        }
+
+        void analyze( const NodeList<Stmt*>& statements )
+        {
+            resolve( statements );
+
+            // A global can be assigned from a function declared before it,
+            // or declared twice, so this is only known once the whole
+            // program has been seen.
+            for ( Var* global : m_globalVars )
+            {
+                Symbol name = global->name.getSymbol();
+                if ( m_globalDeclarations[name] > 1 ||
+                     m_assignedGlobals.count( name ) )
+                    m_reassigned.insert( global );
+            }
+        }
+
+        void visit( Block* stmt ) override
+        {
+            beginScope();
+            resolve( stmt->statements );
+            endScope();
+        }
+
+        void visit( ClassStmt* stmt ) override
+        {
+            declare( stmt->name, nullptr );
+
+            if ( stmt->superclass )
+            {
+                beginScope();
+                m_slots.push_back( nullptr );
+            }
+
+            for ( auto&& method : stmt->methods )
+            {
+                resolveFunction( method, true );
+            }
+
+            if ( stmt->superclass )
+                endScope();
+        }
+
+        void visit( Expression* stmt ) override
+        {
+            resolve( stmt->expression );
+        }
+
+        void visit( Function* stmt ) override
+        {
+            declare( stmt->name, nullptr );
+            resolveFunction( stmt, false );
+        }
+
+        void visit( If* stmt ) override
+        {
+            resolve( stmt->condition );
+            resolve( stmt->thenBranch );
+            if ( stmt->elseBranch )
+                resolve( stmt->elseBranch );
+        }
+
+        void visit( Print* stmt ) override
+        {
+            resolve( stmt->expression );
+        }
+
+        void visit( Return* stmt ) override
+        {
+            if ( stmt->value )
+                resolve( stmt->value );
+        }
+
+        void visit( Var* stmt ) override
+        {
+            declare( stmt->name, stmt );
+            if ( stmt->initializer )
+                resolve( stmt->initializer );
+        }
+
+        void visit( While* stmt ) override
+        {
+            resolve( stmt->condition );
+            resolve( stmt->body );
+        }
+
+        void visit( Assign* expr ) override
+        {
+            resolve( expr->value );
+
+            const Location& location = expr->location;
+            if ( location.isGlobal() )
+            {
+                m_assignedGlobals.insert( expr->name.getSymbol() );
+                return;
+            }
+
+            // Assignments through a closure count too.
+            auto [scope, slot] =
+                findLocal( location, m_functions, m_scopes.size() );
+            if ( Var* declaration = m_slots[m_scopes[scope] + slot] )
+                m_reassigned.insert( declaration );
+        }
+
+        void visit( Binary* expr ) override
+        {
+            resolve( expr->left );
+            resolve( expr->right );
+        }
+
+        void visit( Call* expr ) override
+        {
+            resolve( expr->callee );
+            for ( auto&& argument : expr->arguments )
+            {
+                resolve( argument );
+            }
+        }
+
+        void visit( Get* expr ) override
+        {
+            resolve( expr->object );
+        }
+
+        void visit( Grouping* expr ) override
+        {
+            resolve( expr->expr );
+        }
+
+        void visit( Literal* ) override
+        {
+        }
+
+        void visit( Logical* expr ) override
+        {
+            resolve( expr->left );
+            resolve( expr->right );
+        }
+
+        void visit( Set* expr ) override
+        {
+            resolve( expr->value );
+            resolve( expr->object );
+        }
+
+        void visit( Super* ) override
+        {
+        }
+
+        void visit( This* ) override
+        {
+        }
+
+        void visit( Unary* expr ) override
+        {
+            resolve( expr->right );
+        }
+
+        void visit( Variable* ) override
+        {
+        }
+
+    private:
+        void resolve( const NodeList<Stmt*>& statements )
+        {
+            for ( auto&& statement : statements )
+            {
+                resolve( statement );
+            }
+        }
+
+        void resolve( Stmt* stmt )
+        {
+            stmt->accept( this );
+        }
+
+        void resolve( Expr* expr )
+        {
+            expr->accept( this );
+        }
+
+        void beginScope()
+        {
+            m_scopes.push_back( m_slots.size() );
+        }
+
+        void endScope()
+        {
+            m_slots.resize( m_scopes.back() );
+            m_scopes.pop_back();
+        }
+
+        void resolveFunction( Function* function, bool isMethod )
+        {
+            m_functions.push_back( { function, m_scopes.size() } );
+            beginScope();
+            if ( isMethod )
+                m_slots.push_back( nullptr );
+            for ( const auto& param : function->params )
+            {
+                declare( param, nullptr );
+            }
+            resolve( function->body );
+            endScope();
+            m_functions.pop_back();
+        }
+
+        // Parameters, functions and classes take a slot too, but are
+        // recorded as nullptr since they are never propagated.
+        void declare( const Token& name, Var* declaration )
+        {
+            if ( !m_scopes.empty() )
+            {
+                m_slots.push_back( declaration );
+                return;
+            }
+
+            ++m_globalDeclarations[name.getSymbol()];
+            if ( declaration )
+                m_globalVars.push_back( declaration );
+        }
+
+        struct FunctionScope
+        {
+            Function* function;
+            std::size_t firstScope;
+        };
+
+        std::unordered_set<Var*>& m_reassigned;
+        std::vector<Var*> m_slots{};
+        std::vector<std::size_t> m_scopes{};
+        std::vector<FunctionScope> m_functions{};
+        std::unordered_map<Symbol, int> m_globalDeclarations{};
+        std::unordered_set<Symbol> m_assignedGlobals{};
+        std::vector<Var*> m_globalVars{};
+    };
+
+    bool isTruthy( const Object& value )
+    {
+        if ( value.isNil() )
+            return false;
+        if ( value.isBool() )
+            return value.asBool();
+        return true;
+    }
+
+    Literal* asLiteral( Expr* expr )
+    {
+        return dynamic_cast<Literal*>( expr );
+    }
+} // namespace
+
+ConstantFolder::ConstantFolder( Arena& arena, bool propagateGlobals )
+    : m_arena{ arena }, m_propagateGlobals{ propagateGlobals }
+{
+}
+
+const char* ConstantFolder::getName() const
+{
+    return "constant-folding";
+}
+
+void ConstantFolder::run( NodeList<Stmt*>& statements )
+{
+    AssignmentAnalysis analysis{ m_reassigned };
+    analysis.analyze( statements );
+
+    foldList( statements );
+}
+
+void ConstantFolder::visit( Block* stmt )
+{
+    beginScope();
+    foldList( stmt->statements );
+    endScope();
+    m_stmt = stmt;
+}
+
+void ConstantFolder::visit( ClassStmt* stmt )
+{
+    declare( Binding{} );
+
+    if ( stmt->superclass )
+    {
+        beginScope();
+        declare( Binding{} );
+    }
+
+    for ( auto&& method : stmt->methods )
+    {
+        foldFunction( method, true );
+    }
+
+    if ( stmt->superclass )
+        endScope();
+
+    m_stmt = stmt;
+}
+
+void ConstantFolder::visit( Expression* stmt )
+{
+    stmt->expression = fold( stmt->expression );
+
+    // A bare constant has no effect.
+    m_stmt = asLiteral( stmt->expression ) ? nullptr : stmt;
+}
+
+void ConstantFolder::visit( Function* stmt )
+{
+    declare( Binding{} );
+    foldFunction( stmt, false );
+    m_stmt = stmt;
+}
+
+void ConstantFolder::visit( If* stmt )
+{
+    stmt->condition = fold( stmt->condition );
+
+    if ( Literal* condition = asLiteral( stmt->condition ) )
+    {
+        // Neither branch can be a declaration, so the one that is taken can
+        // stand in for the whole statement.
+        if ( isTruthy( condition->value ) )
+            m_stmt = fold( stmt->thenBranch );
+        else
+            m_stmt = stmt->elseBranch ? fold( stmt->elseBranch ) : nullptr;
+        return;
+    }
+
+    stmt->thenBranch = foldBranch( stmt->thenBranch );
+    if ( stmt->elseBranch )
+        stmt->elseBranch = fold( stmt->elseBranch );
+    m_stmt = stmt;
+}
+
+void ConstantFolder::visit( Print* stmt )
+{
+    stmt->expression = fold( stmt->expression );
+    m_stmt = stmt;
+}
+
+void ConstantFolder::visit( Return* stmt )
+{
+    if ( stmt->value )
+        stmt->value = fold( stmt->value );
+    m_stmt = stmt;
+}
+
+void ConstantFolder::visit( Var* stmt )
+{
+    m_stmt = stmt;
+
+    // Declared before the initializer is folded, as the Resolver does.
+    bool isGlobal = m_scopes.empty();
+    if ( !isGlobal )
+        declare( Binding{} );
+
+    Object value{ std::monostate{} };
+    if ( stmt->initializer )
+    {
+        stmt->initializer = fold( stmt->initializer );
+
+        Literal* initializer = asLiteral( stmt->initializer );
+        if ( !initializer )
+            return;
+        value = initializer->value;
+    }
+
+    if ( m_reassigned.count( stmt ) )
+        return;
+
+    if ( !isGlobal )
+        m_slots.back() = Binding{ std::move( value ), true };
+    else if ( m_propagateGlobals )
+        m_globals[stmt->name.getSymbol()] = std::move( value );
+}
+
+void ConstantFolder::visit( While* stmt )
+{
+    stmt->condition = fold( stmt->condition );
+
+    Literal* condition = asLiteral( stmt->condition );
+    if ( condition && !isTruthy( condition->value ) )
+    {
+        m_stmt = nullptr;
+        return;
+    }
+
+    stmt->body = foldBranch( stmt->body );
+    m_stmt = stmt;
+}
+
+void ConstantFolder::visit( Assign* expr )
+{
+    expr->value = fold( expr->value );
+    m_expr = expr;
+}
+
+void ConstantFolder::visit( Binary* expr )
+{
+    expr->left = fold( expr->left );
+    expr->right = fold( expr->right );
+    m_expr = expr;
+
+    Literal* leftLiteral = asLiteral( expr->left );
+    Literal* rightLiteral = asLiteral( expr->right );
+    if ( !leftLiteral || !rightLiteral )
+        return;
+
+    const Object& left = leftLiteral->value;
+    const Object& right = rightLiteral->value;
+    TokenType::Type type = expr->op.getType();
+
+    if ( type == TokenType::EQUAL_EQUAL )
+    {
+        m_expr = literal( left == right );
+        return;
+    }
+    if ( type == TokenType::BANG_EQUAL )
+    {
+        m_expr = literal( left != right );
+        return;
+    }
+
+    if ( type == TokenType::PLUS && left.isString() && right.isString() )
+    {
+        m_expr = literal( left.asString() + right.asString() );
+        return;
+    }
+
+    // Anything else with a non-number operand is a runtime error, which is
+    // left for the interpreter to report.
+    if ( !left.isNumber() || !right.isNumber() )
+        return;
+
+    double a = left.asNumber();
+    double b = right.asNumber();
+    switch ( type )
+    {
+    case TokenType::PLUS:
+        m_expr = literal( a + b );
+        break;
+    case TokenType::MINUS:
+        m_expr = literal( a - b );
+        break;
+    case TokenType::STAR:
+        m_expr = literal( a * b );
+        break;
+    case TokenType::SLASH:
+        m_expr = literal( a / b );
+        break;
+    case TokenType::GREATER:
+        m_expr = literal( a > b );
+        break;
+    case TokenType::GREATER_EQUAL:
+        m_expr = literal( a >= b );
+        break;
+    case TokenType::LESS:
+        m_expr = literal( a < b );
+        break;
+    case TokenType::LESS_EQUAL:
+        m_expr = literal( a <= b );
+        break;
+    default:
+        break;
+    }
+}
+
+void ConstantFolder::visit( Call* expr )
+{
+    // A method call's callee stays the Get the Parser recorded in
+    // 'property'; folding a Get never replaces it.
+    expr->callee = fold( expr->callee );
+    for ( auto&& argument : expr->arguments )
+    {
+        argument = fold( argument );
+    }
+    m_expr = expr;
+}
+
+void ConstantFolder::visit( Get* expr )
+{
+    expr->object = fold( expr->object );
+    m_expr = expr;
+}
+
+void ConstantFolder::visit( Grouping* expr )
+{
+    // Parentheses only matter to the Parser.
+    m_expr = fold( expr->expr );
+}
+
+void ConstantFolder::visit( Literal* expr )
+{
+    m_expr = expr;
+}
+
+void ConstantFolder::visit( Logical* expr )
+{
+    expr->left = fold( expr->left );
+    expr->right = fold( expr->right );
+    m_expr = expr;
+
+    Literal* left = asLiteral( expr->left );
+    if ( !left )
+        return;
+
+    // The result is the left operand when it decides the outcome, and the
+    // right operand otherwise.
+    bool decided = expr->op.getType() == TokenType::OR
+                       ? isTruthy( left->value )
+                       : !isTruthy( left->value );
+    m_expr = decided ? expr->left : expr->right;
+}
+
+void ConstantFolder::visit( Set* expr )
+{
+    expr->object = fold( expr->object );
+    expr->value = fold( expr->value );
+    m_expr = expr;
+}
+
+void ConstantFolder::visit( Super* expr )
+{
+    m_expr = expr;
+}
+
+void ConstantFolder::visit( This* expr )
+{
+    m_expr = expr;
+}
+
+void ConstantFolder::visit( Unary* expr )
+{
+    expr->right = fold( expr->right );
+    m_expr = expr;
+
+    Literal* right = asLiteral( expr->right );
+    if ( !right )
+        return;
+
+    if ( expr->op.getType() == TokenType::BANG )
+        m_expr = literal( !isTruthy( right->value ) );
+    else if ( right->value.isNumber() )
+        m_expr = literal( -right->value.asNumber() );
+}
+
+void ConstantFolder::visit( Variable* expr )
+{
+    m_expr = expr;
+
+    if ( !expr->location.isGlobal() )
+    {
+        const Binding& binding = lookUp( expr->location );
+        if ( binding.constant )
+            m_expr = literal( binding.value );
+        return;
+    }
+
+    // Globals are recorded as their declarations are folded, in program
+    // order, so a read that may run before its declaration is not replaced.
+    auto global = m_globals.find( expr->name.getSymbol() );
+    if ( global != m_globals.end() )
+        m_expr = literal( global->second );
+}
+
+void ConstantFolder::beginScope()
+{
+    m_scopes.push_back( m_slots.size() );
+}
+
+void ConstantFolder::endScope()
+{
+    m_slots.erase( m_slots.begin() +
+                       static_cast<std::ptrdiff_t>( m_scopes.back() ),
+                   m_slots.end() );
+    m_scopes.pop_back();
+}
+
+void ConstantFolder::declare( const Binding& binding )
+{
+    if ( !m_scopes.empty() )
+        m_slots.push_back( binding );
+}
+
+ConstantFolder::Binding& ConstantFolder::lookUp( const Location& location )
+{
+    auto [scope, slot] = findLocal( location, m_functions, m_scopes.size() );
+    return m_slots[m_scopes[scope] + slot];
+}
+
+void ConstantFolder::foldFunction( Function* function, bool isMethod )
+{
+    m_functions.push_back( { function, m_scopes.size() } );
+    beginScope();
+    if ( isMethod )
+        declare( Binding{} );
+    for ( std::size_t i = 0; i < function->params.size(); ++i )
+    {
+        declare( Binding{} );
+    }
+    foldList( function->body );
+    endScope();
+    m_functions.pop_back();
+}
+
+void ConstantFolder::foldList( NodeList<Stmt*>& statements )
+{
+    // Compact the list in place, dropping statements that folded away.
+    std::uint32_t count = 0;
+    for ( auto&& statement : statements )
+    {
+        if ( Stmt* folded = fold( statement ) )
+            statements[count++] = folded;
+    }
+    statements = NodeList<Stmt*>{ statements.begin(), count };
+}
+
+Expr* ConstantFolder::fold( Expr* expr )
+{
+    expr->accept( this );
+    return m_expr;
+}
+
+Stmt* ConstantFolder::fold( Stmt* stmt )
+{
+    stmt->accept( this );
+    return m_stmt;
+}
+
+Stmt* ConstantFolder::foldBranch( Stmt* stmt )
+{
+    // Loop bodies and then-branches must still be statements.
+    if ( Stmt* folded = fold( stmt ) )
+        return folded;
+    return m_arena.make<Block>( NodeList<Stmt*>{} );
+}
+
+Literal* ConstantFolder::literal( const Object& value )
+{
+    return m_arena.make<Literal>( value );
+}
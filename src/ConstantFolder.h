@@ -0,0 +1,98 @@
+#pragma once
+#include <cstddef>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Arena.h"
+#include "Expression.h"
+#include "Object.h"
+#include "PassManager.h"
+#include "Symbol.h"
+#include "Visitor.h"
+
+struct Function;
+struct Stmt;
+
+// Rewrites a resolved program in place: folds operators whose operands are
+// literals, replaces reads of variables that are initialized with a constant
+// and never reassigned, and drops branches and loops whose condition is a
+// constant. Nothing that could raise a runtime error is folded, so a program
+// fails at the same point with the same message as before.
+//
+// Declarations are never removed, since the Resolver has already numbered
+// the slots of every scope.
+class ConstantFolder : public Pass, public IVisitor
+{
+public:
+    // Globals are only propagated when the program is seen as a whole; a
+    // later REPL line could still assign to them.
+    ConstantFolder( Arena& arena, bool propagateGlobals );
+
+    const char* getName() const override;
+    void run( NodeList<Stmt*>& statements ) override;
+
+    void visit( Block* stmt ) override;
+    void visit( ClassStmt* stmt ) override;
+    void visit( Expression* stmt ) override;
+    void visit( Function* stmt ) override;
+    void visit( If* stmt ) override;
+    void visit( Print* stmt ) override;
+    void visit( Return* stmt ) override;
+    void visit( Var* stmt ) override;
+    void visit( While* stmt ) override;
+
+    void visit( Assign* expr ) override;
+    void visit( Binary* expr ) override;
+    void visit( Call* expr ) override;
+    void visit( Get* expr ) override;
+    void visit( Grouping* expr ) override;
+    void visit( Literal* expr ) override;
+    void visit( Logical* expr ) override;
+    void visit( Set* expr ) override;
+    void visit( Super* expr ) override;
+    void visit( This* expr ) override;
+    void visit( Unary* expr ) override;
+    void visit( Variable* expr ) override;
+
+private:
+    // What is known about a local slot. Scopes are laid out exactly as the
+    // Resolver numbered them, so a read's Location finds its slot directly.
+    struct Binding
+    {
+        Object value{};
+        bool constant{ false };
+    };
+
+    // A function being folded, and the first of m_scopes that is its own.
+    struct FunctionScope
+    {
+        Function* function;
+        std::size_t firstScope;
+    };
+
+    void beginScope();
+    void endScope();
+    void declare( const Binding& binding );
+    Binding& lookUp( const Location& location );
+    void foldFunction( Function* function, bool isMethod );
+
+    void foldList( NodeList<Stmt*>& statements );
+    Expr* fold( Expr* expr );
+    Stmt* fold( Stmt* stmt );
+    Stmt* foldBranch( Stmt* stmt );
+    Literal* literal( const Object& value );
+
+    Arena& m_arena;
+    bool m_propagateGlobals;
+    std::unordered_set<Var*> m_reassigned{};
+    std::vector<Binding> m_slots{};
+    std::vector<std::size_t> m_scopes{};
+    std::vector<FunctionScope> m_functions{};
+    std::unordered_map<Symbol, Object> m_globals{};
+
+    // What the last visited node was replaced with. A statement that folds
+    // away entirely is replaced with nullptr.
+    Expr* m_expr{ nullptr };
+    Stmt* m_stmt{ nullptr };
+};
@@ -0,0 +1,94 @@
+#include <cstdint>
+
+#include "DeadCodeEliminator.h"
+#include "Statement.h"
+
+const char* DeadCodeEliminator::getName() const
+{
+    return "dead-code";
+}
+
+void DeadCodeEliminator::run( NodeList<Stmt*>& statements )
+{
+    eliminate( statements );
+}
+
+void DeadCodeEliminator::visit( Block* stmt )
+{
+    m_returns = eliminate( stmt->statements );
+}
+
+void DeadCodeEliminator::visit( ClassStmt* stmt )
+{
+    for ( auto&& method : stmt->methods )
+    {
+        eliminate( method->body );
+    }
+    m_returns = false;
+}
+
+void DeadCodeEliminator::visit( Expression* )
+{
+    m_returns = false;
+}
+
+void DeadCodeEliminator::visit( Function* stmt )
+{
+    eliminate( stmt->body );
+    m_returns = false;
+}
+
+void DeadCodeEliminator::visit( If* stmt )
+{
+    bool thenReturns = eliminate( stmt->thenBranch );
+    bool elseReturns = stmt->elseBranch && eliminate( stmt->elseBranch );
+    m_returns = thenReturns && elseReturns;
+}
+
+void DeadCodeEliminator::visit( Print* )
+{
+    m_returns = false;
+}
+
+void DeadCodeEliminator::visit( Return* )
+{
+    m_returns = true;
+}
+
+void DeadCodeEliminator::visit( Var* )
+{
+    m_returns = false;
+}
+
+void DeadCodeEliminator::visit( While* stmt )
+{
+    // The body may not run at all.
+    eliminate( stmt->body );
+    m_returns = false;
+}
+
+bool DeadCodeEliminator::eliminate( NodeList<Stmt*>& statements )
+{
+    std::uint32_t count = 0;
+    bool returns = false;
+    for ( auto&& statement : statements )
+    {
+        returns = eliminate( statement );
+
+        Block* block = dynamic_cast<Block*>( statement );
+        if ( !block || !block->statements.empty() )
+            statements[count++] = statement;
+
+        if ( returns )
+            break;
+    }
+
+    statements = NodeList<Stmt*>{ statements.begin(), count };
+    return returns;
+}
+
+bool DeadCodeEliminator::eliminate( Stmt* stmt )
+{
+    stmt->accept( this );
+    return m_returns;
+}
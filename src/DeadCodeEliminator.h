@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Arena.h"
+#include "PassManager.h"
+#include "Visitor.h"
+
+struct Stmt;
+
+// Removes statements that can never run because an earlier statement in the
+// same list always returns, and empty blocks that are not needed as a
+// branch or loop body.
+//
+// Declarations after a return are dropped too. Their slots are numbered
+// after every reachable one, so the slots the Resolver assigned to the
+// statements that remain do not change.
+class DeadCodeEliminator : public Pass, public IStmtVisitor
+{
+public:
+    const char* getName() const override;
+    void run( NodeList<Stmt*>& statements ) override;
+
+    void visit( Block* stmt ) override;
+    void visit( ClassStmt* stmt ) override;
+    void visit( Expression* stmt ) override;
+    void visit( Function* stmt ) override;
+    void visit( If* stmt ) override;
+    void visit( Print* stmt ) override;
+    void visit( Return* stmt ) override;
+    void visit( Var* stmt ) override;
+    void visit( While* stmt ) override;
+
+private:
+    // Both return whether the statements always return.
+    bool eliminate( NodeList<Stmt*>& statements );
+    bool eliminate( Stmt* stmt );
+
+    bool m_returns{ false };
+};
@@ -3,16 +3,22 @@
 #include <memory>
 #include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "Arena.h"
+#include "ClosureCompiler.h"
+#include "Compiler.h"
 #include "Driver.h"
 #include "Error.h"
 #include "Interpreter.h"
 #include "Parser.h"
+#include "PassManager.h"
 #include "Resolver.h"
 #include "Scanner.h"
 #include "Statement.h"
 #include "Token.h"
+#include "VM.h"
 
 void Driver::runFile( const std::string& path )
 {
@@ -50,27 +56,65 @@ void Driver::runPrompt()
         if ( !std::cin )
             break;
 
-        Driver::run( line );
+        Driver::run( line, true );
         Error::hadError = false;
     }
 }
 
-void Driver::run( const std::string& source )
+void Driver::run( const std::string& source, bool interactive )
 {
-    Scanner scanner{ source };
-    std::vector<Token> tokens{ scanner.scanTokens() };
+    // Functions keep pointers into the AST they were declared in, so the
+    // arena of a program that declares any lives as long as the interpreter.
+    // Any other program, such as most lines typed into the REPL, is freed
+    // when this returns.
+    static std::vector<std::unique_ptr<Arena>> programs{};
+    std::unique_ptr<Arena> program = std::make_unique<Arena>();
+    Arena& arena = *program;
+
+    // The tokens are only needed while parsing.
+    NodeList<Stmt*> statements{};
+    {
+        Scanner scanner{ source };
+        Parser parser{ scanner.scanTokens(), arena };
+        statements = parser.parse();
 
-    Parser parser{ tokens };
-    std::vector<std::unique_ptr<Stmt>> statements = parser.parse();
+        if ( parser.declaresFunctions() )
+            programs.push_back( std::move( program ) );
+    }
 
     if ( Error::hadError )
         return;
 
-    Resolver resolver{ interpreter };
+    Resolver resolver{};
     resolver.resolve( statements );
 
     if ( Error::hadError )
         return;
 
+    PassManager passes{ arena, interactive };
+    passes.run( statements );
+
+    if ( Driver::backend == Backend::VM )
+    {
+        // Created on first use so the tree-walker never pays for its stack.
+        static VM vm{ interpreter };
+
+        Compiler compiler{ vm.getGlobals() };
+        std::shared_ptr<VMFunction> script = compiler.compile( statements );
+
+        if ( Error::hadError )
+            return;
+
+        vm.interpret( script );
+        return;
+    }
+
+    if ( Driver::backend == Backend::CLOSURES )
+    {
+        ClosureCompiler compiler{};
+        Driver::interpreter.interpret( compiler.compile( statements ) );
+        return;
+    }
+
     Driver::interpreter.interpret( statements );
 }
@@ -5,8 +5,19 @@
 
 namespace Driver
 {
+    enum class Backend
+    {
+        TREE_WALKER,
+        CLOSURES,
+        VM
+    };
+
+    inline Backend backend{ Backend::TREE_WALKER };
+
     void runFile( const std::string& path );
     void runPrompt();
-    void run( const std::string& source );
+    // An interactive run is one line of a REPL session, which later lines
+    // can still add to.
+    void run( const std::string& source, bool interactive = false );
     static Interpreter interpreter{};
 } // namespace Driver
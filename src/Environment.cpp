@@ -1,66 +1,48 @@
-#include <memory>
-
 #include "Environment.h"
 #include "Error.h"
 #include "Object.h"
 
-void Environment::define( const std::string& name, const Object& value )
+std::size_t Environment::indexOf( Symbol name )
 {
-    m_values[name] = value;
+    return m_globals.indexOf( name );
 }
 
-Environment* Environment::ancestor( int distance )
+void Environment::define( Symbol name, const Object& value )
 {
-    Environment* environment = this;
-    for ( int i = 0; i < distance; ++i )
-    {
-        environment = environment->m_enclosing.get();
-    }
-
-    return environment;
+    GlobalTable::Slot& slot = m_globals[m_globals.indexOf( name )];
+    slot.value = value;
+    slot.defined = true;
 }
 
-Object Environment::getAt( int distance, const std::string& name )
+const Object* Environment::find( Symbol name ) const
 {
-    return ancestor( distance )->m_values[name];
+    const GlobalTable::Slot* slot = m_globals.find( name );
+    return slot && slot->defined ? &slot->value : nullptr;
 }
 
-void Environment::assignAt( int distance, const Token& name,
-                            const Object& value )
+void Environment::undefined( const Token& name )
 {
-    ancestor( distance )->m_values[name.getLexeme()] = value;
+    throw Error::RuntimeError{ name, "Undefined variable '" + name.getLexeme() +
+                                         "'." };
 }
 
-Object Environment::get( const Token& name )
+void Environment::traverse( HeapVisitor& visitor ) const
 {
-    if ( m_values.find( name.getLexeme() ) != m_values.end() )
-    {
-        return m_values[name.getLexeme()];
-    }
-
-    if ( m_enclosing )
-    {
-        return m_enclosing->get( name );
-    }
-
-    throw Error::RuntimeError{ name, "Undefined variable '" + name.getLexeme() +
-                                         "'." };
+    for ( std::size_t i = 0; i < m_globals.size(); ++i )
+        visitor.visit( m_globals[i].value );
 }
 
-void Environment::assign( const Token& name, const Object& value )
+void Environment::clear()
 {
-    if ( m_values.find( name.getLexeme() ) != m_values.end() )
-    {
-        m_values[name.getLexeme()] = value;
-        return;
-    }
+    m_globals = GlobalTable{};
+}
 
-    if ( m_enclosing )
-    {
-        m_enclosing->assign( name, value );
-        return;
-    }
+void Cell::traverse( HeapVisitor& visitor ) const
+{
+    visitor.visit( value );
+}
 
-    throw Error::RuntimeError( name, "Undefined variable '" + name.getLexeme() +
-                                         "'." );
-}
\ No newline at end of file
+void Cell::clear()
+{
+    value = Object{ std::monostate{} };
+}
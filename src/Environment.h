@@ -1,33 +1,69 @@
 #pragma once
-#include <map>
-#include <memory>
-#include <string>
+#include <cstddef>
 
+#include "GlobalTable.h"
+#include "HeapObject.h"
 #include "Object.h"
+#include "Symbol.h"
 #include "Token.h"
 
-class Environment
+// The global scope of the tree-walker. Globals can be referenced before
+// they are defined, so the Resolver leaves them unresolved, and a Variable
+// or Assign node binds to a global's index the first time it runs. A name
+// keeps its index for the whole session: a global defined later in the
+// script, or declared again on a later REPL line, is found through the same
+// index. Locals live on the Interpreter's frame stack instead.
+class Environment : public HeapObject
 {
 public:
-    Environment()
+    Environment() : HeapObject{ Kind::ENVIRONMENT }
     {
-        m_enclosing = nullptr;
     }
 
-    Environment( std::shared_ptr<Environment> enclosing )
-        : m_enclosing{ enclosing }
+    std::size_t indexOf( Symbol name );
+    void define( Symbol name, const Object& value );
+
+    const Object& get( const Token& name, std::size_t index )
     {
+        GlobalTable::Slot& slot = m_globals[index];
+        if ( !slot.defined )
+            undefined( name );
+        return slot.value;
     }
 
-    void define( const std::string& name, const Object& value );
-    Environment* ancestor( int distance );
-    Object getAt( int distance, const std::string& name );
-    void assignAt( int distance, const Token& name, const Object& value );
-    Object get( const Token& name );
-    void assign( const Token& name, const Object& value );
+    void assign( const Token& name, std::size_t index, const Object& value )
+    {
+        GlobalTable::Slot& slot = m_globals[index];
+        if ( !slot.defined )
+            undefined( name );
+        slot.value = value;
+    }
 
-    std::shared_ptr<Environment> m_enclosing = nullptr;
+    // The storage of a global, which stays where it is for as long as the
+    // environment lives, or nullptr if the global is not defined.
+    const Object* find( Symbol name ) const;
+    void traverse( HeapVisitor& visitor ) const override;
+    void clear() override;
 
 private:
-    std::map<std::string, Object> m_values{};
+    [[noreturn]] static void undefined( const Token& name );
+
+    GlobalTable m_globals{};
+};
+
+// A local that a closure captures. The variable's slot holds the cell
+// rather than the value, and every closure that captures the variable holds
+// the same cell, so an assignment through any of them is seen by all.
+class Cell : public HeapObject
+{
+public:
+    explicit Cell( const Object& value )
+        : HeapObject{ Kind::CELL }, value{ value }
+    {
+    }
+
+    void traverse( HeapVisitor& visitor ) const override;
+    void clear() override;
+
+    Object value;
 };
@@ -1,62 +1,123 @@
 #include "Expression.h"
+#include "Object.h"
 #include "Visitor.h"
 
-void Assign::accept( IVisitor* visitor )
+void Assign::accept( IExprVisitor* visitor )
 {
     visitor->visit( this );
 }
 
-void Binary::accept( IVisitor* visitor )
+Object Assign::accept( IValueVisitor* visitor )
+{
+    return visitor->visit( this );
+}
+
+void Binary::accept( IExprVisitor* visitor )
 {
     visitor->visit( this );
 }
 
-void Call::accept( IVisitor* visitor )
+Object Binary::accept( IValueVisitor* visitor )
+{
+    return visitor->visit( this );
+}
+
+void Call::accept( IExprVisitor* visitor )
 {
     visitor->visit( this );
 }
 
-void Get::accept( IVisitor* visitor )
+Object Call::accept( IValueVisitor* visitor )
+{
+    return visitor->visit( this );
+}
+
+void Get::accept( IExprVisitor* visitor )
 {
     visitor->visit( this );
 }
 
-void Grouping::accept( IVisitor* visitor )
+Object Get::accept( IValueVisitor* visitor )
+{
+    return visitor->visit( this );
+}
+
+void Grouping::accept( IExprVisitor* visitor )
 {
     visitor->visit( this );
 }
 
-void Literal::accept( IVisitor* visitor )
+Object Grouping::accept( IValueVisitor* visitor )
+{
+    return visitor->visit( this );
+}
+
+void Literal::accept( IExprVisitor* visitor )
 {
     visitor->visit( this );
 }
 
-void Logical::accept( IVisitor* visitor )
+Object Literal::accept( IValueVisitor* visitor )
+{
+    return visitor->visit( this );
+}
+
+void Logical::accept( IExprVisitor* visitor )
 {
     visitor->visit( this );
 }
 
-void Set::accept( IVisitor* visitor )
+Object Logical::accept( IValueVisitor* visitor )
+{
+    return visitor->visit( this );
+}
+
+void Set::accept( IExprVisitor* visitor )
 {
     visitor->visit( this );
 }
 
-void Super::accept( IVisitor* visitor )
+Object Set::accept( IValueVisitor* visitor )
+{
+    return visitor->visit( this );
+}
+
+void Super::accept( IExprVisitor* visitor )
 {
     visitor->visit( this );
 }
 
-void This::accept( IVisitor* visitor )
+Object Super::accept( IValueVisitor* visitor )
+{
+    return visitor->visit( this );
+}
+
+void This::accept( IExprVisitor* visitor )
 {
     visitor->visit( this );
 }
 
-void Unary::accept( IVisitor* visitor )
+Object This::accept( IValueVisitor* visitor )
+{
+    return visitor->visit( this );
+}
+
+void Unary::accept( IExprVisitor* visitor )
 {
     visitor->visit( this );
 }
 
-void Variable::accept( IVisitor* visitor )
+Object Unary::accept( IValueVisitor* visitor )
+{
+    return visitor->visit( this );
+}
+
+void Variable::accept( IExprVisitor* visitor )
 {
     visitor->visit( this );
+}
+
+Object Variable::accept( IValueVisitor* visitor )
+{
+    return visitor->visit( this );
 }
\ No newline at end of file
@@ -1,90 +1,161 @@
 #pragma once
-#include <memory>
+#include <cstdint>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "Arena.h"
 #include "Object.h"
+#include "Shape.h"
 #include "Token.h"
 #include "Visitor.h"
 
+// Where the Resolver found a variable. A local of the current function is
+// found by how many scopes to walk up and its index within that scope. A
+// local of an enclosing function is one of the current closure's captured
+// cells, and 'slot' is its index. Unresolved variables are globals, which
+// are bound to their index in the table of globals at runtime.
+struct Location
+{
+    static constexpr int GLOBAL = -1;
+    static constexpr int UPVALUE = -2;
+    static constexpr std::uint32_t UNBOUND = UINT32_MAX;
+
+    bool isGlobal() const
+    {
+        return depth == GLOBAL;
+    }
+
+    bool isUpvalue() const
+    {
+        return depth == UPVALUE;
+    }
+
+    int depth{ GLOBAL };
+    int slot{ 0 };
+
+    // The local is captured by a closure, so its slot holds a Cell shared
+    // with the closure rather than the value itself.
+    bool captured{ false };
+
+    // A global's index in the Interpreter's globals, once the node has run.
+    std::uint32_t global{ UNBOUND };
+};
+
+// The operation a Binary or Unary node has specialized itself to, from the
+// operand types it saw the first time it ran. A specialized node checks its
+// guard and takes the fast path; when the guard fails it falls back to the
+// generic path for good.
+enum class Specialization : std::uint8_t
+{
+    UNINITIALIZED,
+    GENERIC,
+    NUMBER_ADD,
+    NUMBER_SUBTRACT,
+    NUMBER_MULTIPLY,
+    NUMBER_DIVIDE,
+    NUMBER_GREATER,
+    NUMBER_GREATER_EQUAL,
+    NUMBER_LESS,
+    NUMBER_LESS_EQUAL,
+    NUMBER_EQUAL,
+    NUMBER_NOT_EQUAL,
+    NUMBER_NEGATE,
+    STRING_CONCAT,
+    NOT
+};
+
+class LoxFunction;
+struct Get;
+
+// AST nodes are allocated in the Arena of the program they were parsed from,
+// and refer to their children with plain pointers into it.
 struct Expr
 {
-    virtual void accept( IVisitor* visitor ) = 0;
+    virtual void accept( IExprVisitor* visitor ) = 0;
+    virtual Object accept( IValueVisitor* visitor ) = 0;
     virtual ~Expr() = default;
 };
 
 struct Assign : public Expr
 {
-    void accept( IVisitor* visitor ) override;
+    void accept( IExprVisitor* visitor ) override;
+    Object accept( IValueVisitor* visitor ) override;
 
-    Assign( const Token& name, std::unique_ptr<Expr> value )
-        : name{ name }, value{ std::move( value ) }
+    Assign( const Token& name, Expr* value ) : name{ name }, value{ value }
     {
     }
 
     Token name;
-    std::unique_ptr<Expr> value;
+    Expr* value;
+    Location location{};
 };
 
 struct Binary : public Expr
 {
-    void accept( IVisitor* visitor ) override;
+    void accept( IExprVisitor* visitor ) override;
+    Object accept( IValueVisitor* visitor ) override;
 
-    Binary( std::unique_ptr<Expr> left, const Token& op,
-            std::unique_ptr<Expr> right )
-        : left{ std::move( left ) }, op{ op }, right{ std::move( right ) }
+    Binary( Expr* left, const Token& op, Expr* right )
+        : left{ left }, op{ op }, right{ right }
     {
     }
 
-    std::unique_ptr<Expr> left;
+    Expr* left;
     Token op;
-    std::unique_ptr<Expr> right;
+    Expr* right;
+    Specialization specialization{ Specialization::UNINITIALIZED };
 };
 
 struct Call : public Expr
 {
-    void accept( IVisitor* visitor ) override;
+    void accept( IExprVisitor* visitor ) override;
+    Object accept( IValueVisitor* visitor ) override;
 
-    Call( std::unique_ptr<Expr> callee, const Token& paren,
-          std::vector<std::unique_ptr<Expr>> arguments )
-        : callee{ std::move( callee ) }, paren{ paren },
-          arguments{ std::move( arguments ) }
+    Call( Expr* callee, const Token& paren, NodeList<Expr*> arguments )
+        : callee{ callee }, paren{ paren }, arguments{ arguments }
     {
     }
 
-    std::unique_ptr<Expr> callee;
+    Expr* callee;
     Token paren;
-    std::vector<std::unique_ptr<Expr>> arguments;
+    NodeList<Expr*> arguments;
+
+    // Set by the Parser when the callee is a property access, so a method
+    // call can run without materializing a bound method.
+    Get* property{ nullptr };
 };
 
 struct Get : public Expr
 {
-    void accept( IVisitor* visitor ) override;
+    void accept( IExprVisitor* visitor ) override;
+    Object accept( IValueVisitor* visitor ) override;
 
-    Get( std::unique_ptr<Expr> object, const Token& name )
-        : object{ std::move( object ) }, name{ name }
+    Get( Expr* object, const Token& name ) : object{ object }, name{ name }
     {
     }
 
-    std::unique_ptr<Expr> object;
+    Expr* object;
     Token name;
+    FieldCache cache{};
 };
 
 struct Grouping : public Expr
 {
-    void accept( IVisitor* visitor ) override;
+    void accept( IExprVisitor* visitor ) override;
+    Object accept( IValueVisitor* visitor ) override;
 
-    Grouping( std::unique_ptr<Expr> expr ) : expr{ std::move( expr ) }
+    Grouping( Expr* expr ) : expr{ expr }
     {
     }
 
-    std::unique_ptr<Expr> expr;
+    Expr* expr;
 };
 
 struct Literal : public Expr
 {
-    void accept( IVisitor* visitor ) override;
+    void accept( IExprVisitor* visitor ) override;
+    Object accept( IValueVisitor* visitor ) override;
 
     Literal( const Object& value ) : value{ value }
     {
@@ -95,38 +166,39 @@ struct Literal : public Expr
 
 struct Logical : public Expr
 {
-    void accept( IVisitor* visitor ) override;
+    void accept( IExprVisitor* visitor ) override;
+    Object accept( IValueVisitor* visitor ) override;
 
-    Logical( std::unique_ptr<Expr> left, const Token& op,
-             std::unique_ptr<Expr> right )
-        : left{ std::move( left ) }, op{ op }, right{ std::move( right ) }
+    Logical( Expr* left, const Token& op, Expr* right )
+        : left{ left }, op{ op }, right{ right }
     {
     }
 
-    std::unique_ptr<Expr> left;
+    Expr* left;
     Token op;
-    std::unique_ptr<Expr> right;
+    Expr* right;
 };
 
 struct Set : public Expr
 {
-    void accept( IVisitor* visitor ) override;
+    void accept( IExprVisitor* visitor ) override;
+    Object accept( IValueVisitor* visitor ) override;
 
-    Set( std::unique_ptr<Expr> object, const Token& name,
-         std::unique_ptr<Expr> value )
-        : object{ std::move( object ) }, name{ name },
-          value{ std::move( value ) }
+    Set( Expr* object, const Token& name, Expr* value )
+        : object{ object }, name{ name }, value{ value }
     {
     }
 
-    std::unique_ptr<Expr> object;
+    Expr* object;
     Token name;
-    std::unique_ptr<Expr> value;
+    Expr* value;
+    FieldCache cache{};
 };
 
 struct Super : public Expr
 {
-    void accept( IVisitor* visitor ) override;
+    void accept( IExprVisitor* visitor ) override;
+    Object accept( IValueVisitor* visitor ) override;
 
     Super( const Token& keyword, const Token& method )
         : keyword{ keyword }, method{ method }
@@ -135,39 +207,54 @@ struct Super : public Expr
 
     Token keyword;
     Token method;
+    Location location{};
+    Location thisLocation{};
+
+    // The method last resolved here, and the id of the superclass it was
+    // found in. A class declaration only runs again inside a function, so
+    // the superclass rarely changes. Nothing is held: the method is only
+    // used while the class with that id is the superclass, which owns it.
+    // Ids are never reused, so a class that died cannot match.
+    std::uint64_t cachedClassId{ 0 };
+    LoxFunction* cachedMethod{ nullptr };
 };
 
 struct This : public Expr
 {
-    void accept( IVisitor* visitor ) override;
+    void accept( IExprVisitor* visitor ) override;
+    Object accept( IValueVisitor* visitor ) override;
 
     This( const Token& keyword ) : keyword{ keyword }
     {
     }
 
     Token keyword;
+    Location location{};
 };
 
 struct Unary : public Expr
 {
-    void accept( IVisitor* visitor ) override;
+    void accept( IExprVisitor* visitor ) override;
+    Object accept( IValueVisitor* visitor ) override;
 
-    Unary( const Token op, std::unique_ptr<Expr> right )
-        : op{ op }, right{ std::move( right ) }
+    Unary( const Token op, Expr* right ) : op{ op }, right{ right }
     {
     }
 
     Token op;
-    std::unique_ptr<Expr> right;
+    Expr* right;
+    Specialization specialization{ Specialization::UNINITIALIZED };
 };
 
 struct Variable : public Expr
 {
-    void accept( IVisitor* visitor ) override;
+    void accept( IExprVisitor* visitor ) override;
+    Object accept( IValueVisitor* visitor ) override;
 
     Variable( const Token& name ) : name{ name }
     {
     }
 
     Token name;
+    Location location{};
 };
@@ -0,0 +1,263 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "GC.h"
+#include "HeapObject.h"
+
+namespace
+{
+    // Plain arrays only: objects owned by static interpreters are released
+    // during static destruction and still unlink themselves from these.
+    std::array<HeapObject*, GC::GENERATIONS> generations{};
+    std::array<std::size_t, GC::GENERATIONS> counts{};
+
+    // Objects promoted into the oldest generation since the last full
+    // collection, and the size of that generation right after it.
+    std::size_t longLivedPending = 0;
+    std::size_t longLivedTotal = 0;
+
+    bool collecting = false;
+} // namespace
+
+class Collector
+{
+public:
+    static void track( HeapObject* object )
+    {
+        link( object, 0 );
+        ++counts[0];
+
+        if ( ++GC::stats.tracked > GC::stats.peakTracked )
+            GC::stats.peakTracked = GC::stats.tracked;
+
+        collectIfNeeded();
+    }
+
+    static void untrack( HeapObject* object )
+    {
+        unlink( object );
+        object->m_generation = HeapObject::UNTRACKED;
+
+        if ( counts[0] > 0 )
+            --counts[0];
+        --GC::stats.tracked;
+    }
+
+    static std::size_t collect( std::size_t generation );
+
+private:
+    static constexpr std::uint8_t COLLECTING = 0xfe;
+
+    // Subtracts references between objects of the collected set, leaving
+    // m_gcRefs with the number of references from outside of it.
+    class ExternalRefs : public HeapVisitor
+    {
+    public:
+        using HeapVisitor::visit;
+
+        void visit( HeapObject* object ) override
+        {
+            if ( object->m_generation == COLLECTING )
+                --object->m_gcRefs;
+        }
+    };
+
+    class Mark : public HeapVisitor
+    {
+    public:
+        using HeapVisitor::visit;
+
+        void visit( HeapObject* object ) override
+        {
+            if ( object->m_generation == COLLECTING && !object->m_reachable )
+            {
+                object->m_reachable = true;
+                pending.push_back( object );
+            }
+        }
+
+        std::vector<HeapObject*> pending{};
+    };
+
+    static void link( HeapObject* object, std::size_t generation )
+    {
+        HeapObject*& head = generations[generation];
+        object->m_generation = static_cast<std::uint8_t>( generation );
+        object->m_gcPrev = nullptr;
+        object->m_gcNext = head;
+        if ( head )
+            head->m_gcPrev = object;
+        head = object;
+    }
+
+    static void unlink( HeapObject* object )
+    {
+        if ( object->m_gcPrev )
+            object->m_gcPrev->m_gcNext = object->m_gcNext;
+        else
+            generations[object->m_generation] = object->m_gcNext;
+
+        if ( object->m_gcNext )
+            object->m_gcNext->m_gcPrev = object->m_gcPrev;
+
+        object->m_gcPrev = nullptr;
+        object->m_gcNext = nullptr;
+    }
+
+    static void collectIfNeeded()
+    {
+        if ( !GC::config.enabled || collecting ||
+             counts[0] <= GC::config.thresholds[0] )
+            return;
+
+        for ( std::size_t i = GC::GENERATIONS; i-- > 0; )
+        {
+            if ( counts[i] <= GC::config.thresholds[i] )
+                continue;
+
+            if ( i == GC::GENERATIONS - 1 &&
+                 static_cast<double>( longLivedPending ) <
+                     static_cast<double>( longLivedTotal ) *
+                         GC::config.fullCollectionRatio )
+                continue;
+
+            collect( i );
+            return;
+        }
+    }
+};
+
+std::size_t Collector::collect( std::size_t generation )
+{
+    if ( collecting )
+        return 0;
+
+    collecting = true;
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<HeapObject*> young{};
+    for ( std::size_t i = 0; i <= generation; ++i )
+    {
+        for ( HeapObject* object = generations[i]; object;
+              object = object->m_gcNext )
+        {
+            young.push_back( object );
+        }
+
+        generations[i] = nullptr;
+        counts[i] = 0;
+    }
+
+    for ( HeapObject* object : young )
+    {
+        object->m_generation = COLLECTING;
+        object->m_gcRefs = static_cast<std::int32_t>( object->m_refCount );
+        object->m_reachable = false;
+    }
+
+    ExternalRefs externalRefs{};
+    for ( HeapObject* object : young )
+        object->traverse( externalRefs );
+
+    // Anything still referenced from outside is a root.
+    Mark mark{};
+    for ( HeapObject* object : young )
+    {
+        if ( object->m_gcRefs > 0 && !object->m_reachable )
+        {
+            object->m_reachable = true;
+            mark.pending.push_back( object );
+        }
+
+        while ( !mark.pending.empty() )
+        {
+            HeapObject* reachable = mark.pending.back();
+            mark.pending.pop_back();
+            reachable->traverse( mark );
+        }
+    }
+
+    std::size_t older = std::min( generation + 1, GC::GENERATIONS - 1 );
+    std::size_t survivors = 0;
+    std::vector<HeapObject*> garbage{};
+    for ( HeapObject* object : young )
+    {
+        object->m_gcPrev = nullptr;
+        object->m_gcNext = nullptr;
+
+        if ( object->m_reachable )
+        {
+            link( object, older );
+            ++survivors;
+        }
+        else
+        {
+            object->m_generation = HeapObject::UNTRACKED;
+            garbage.push_back( object );
+        }
+    }
+
+    if ( generation == GC::GENERATIONS - 1 )
+    {
+        longLivedPending = 0;
+        longLivedTotal = survivors;
+    }
+    else
+    {
+        ++counts[older];
+        if ( older == GC::GENERATIONS - 1 )
+            longLivedPending += survivors;
+    }
+
+    GC::stats.tracked -= garbage.size();
+
+    // Hold every object while the cycles are cut, so none is freed while
+    // another one is still clearing its references to it.
+    for ( HeapObject* object : garbage )
+        object->retain();
+    for ( HeapObject* object : garbage )
+        object->clear();
+    for ( HeapObject* object : garbage )
+        object->release();
+
+    GC::stats.collections[generation]++;
+    GC::stats.objectsFreed += garbage.size();
+    GC::stats.seconds += std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start )
+                             .count();
+
+    collecting = false;
+    return garbage.size();
+}
+
+void GC::track( HeapObject* object )
+{
+    Collector::track( object );
+}
+
+void GC::untrack( HeapObject* object )
+{
+    Collector::untrack( object );
+}
+
+std::size_t GC::collect( std::size_t generation )
+{
+    return Collector::collect(
+        std::min( generation, GC::GENERATIONS - 1 ) );
+}
+
+void GC::printStats( std::ostream& out )
+{
+    out << "[gc] collections:";
+    for ( std::size_t count : stats.collections )
+        out << ' ' << count;
+
+    out << ", freed: " << stats.objectsFreed << ", tracked: " << stats.tracked
+        << " (peak " << stats.peakTracked << ")"
+        << ", time: " << stats.seconds * 1000.0 << " ms\n";
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <ostream>
+
+#include "HeapObject.h"
+
+// Cycle collector for Lox heap objects.
+//
+// Reference counting frees most objects as soon as they become garbage, but
+// not cycles such as a closure stored in a field of the instance one of its
+// captured cells refers to. Every container object is therefore tracked in
+// one of three generations. A collection works out which tracked objects are
+// referenced from outside the set being collected (the interpreter's frame
+// stack and globals, the VM stack, temporaries on the C++ stack), keeps
+// everything reachable from those, and breaks the rest up with clear().
+//
+// New objects start in the youngest generation and are promoted each time
+// they survive a collection, so long-lived objects are rarely examined.
+namespace GC
+{
+    constexpr std::size_t GENERATIONS = 3;
+
+    struct Config
+    {
+        // A generation is collected once its count exceeds its threshold.
+        // The count of the youngest generation is allocations minus
+        // deallocations of tracked objects, and the count of an older one
+        // is the number of collections of the generation below it.
+        std::array<std::size_t, GENERATIONS> thresholds{ 700, 10, 10 };
+
+        // Full collections also wait until the objects promoted to the
+        // oldest generation since the last one make up this share of it, so
+        // a large, stable heap is not rescanned over and over.
+        double fullCollectionRatio{ 0.25 };
+
+        bool enabled{ true };
+    };
+
+    struct Stats
+    {
+        std::array<std::size_t, GENERATIONS> collections{};
+        std::size_t objectsFreed{ 0 };
+        std::size_t tracked{ 0 };
+        std::size_t peakTracked{ 0 };
+        double seconds{ 0.0 };
+    };
+
+    inline Config config{};
+    inline Stats stats{};
+
+    void track( HeapObject* object );
+    void untrack( HeapObject* object );
+
+    // Collects the given generation and all younger ones, and returns the
+    // number of objects freed.
+    std::size_t collect( std::size_t generation = GENERATIONS - 1 );
+
+    void printStats( std::ostream& out );
+} // namespace GC
\ No newline at end of file
@@ -0,0 +1,33 @@
+#include <string>
+
+#include "GlobalTable.h"
+#include "Symbol.h"
+
+std::size_t GlobalTable::indexOf( Symbol name )
+{
+    auto it = m_indices.find( name );
+    if ( it != m_indices.end() )
+        return it->second;
+
+    std::size_t index = m_slots.size();
+    m_indices.emplace( name, index );
+    m_names.push_back( name );
+    m_slots.emplace_back();
+    return index;
+}
+
+const GlobalTable::Slot* GlobalTable::find( Symbol name ) const
+{
+    auto it = m_indices.find( name );
+    return it != m_indices.end() ? &m_slots[it->second] : nullptr;
+}
+
+const std::string& GlobalTable::getName( std::size_t index ) const
+{
+    return m_names.at( index ).getName();
+}
+
+std::size_t GlobalTable::size() const
+{
+    return m_slots.size();
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Object.h"
+#include "Symbol.h"
+
+// Dense storage for global variables. Names are bound to a slot index the
+// first time they are seen, and the slot stays reserved for the rest of the
+// session so code compiled on earlier REPL lines keeps working. Slots never
+// move once they are added, so machine code can refer to them directly.
+class GlobalTable
+{
+public:
+    struct Slot
+    {
+        Object value{ std::monostate{} };
+        bool defined{ false };
+    };
+
+    std::size_t indexOf( Symbol name );
+
+    // The slot 'name' is bound to, or nullptr if it has never been seen.
+    // Unlike indexOf, never reserves a slot.
+    const Slot* find( Symbol name ) const;
+    const std::string& getName( std::size_t index ) const;
+    std::size_t size() const;
+
+    Slot& operator[]( std::size_t index )
+    {
+        return m_slots[index];
+    }
+
+    const Slot& operator[]( std::size_t index ) const
+    {
+        return m_slots[index];
+    }
+
+private:
+    std::unordered_map<Symbol, std::size_t> m_indices{};
+    std::vector<Symbol> m_names{};
+    std::deque<Slot> m_slots{};
+};
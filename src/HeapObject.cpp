@@ -0,0 +1,10 @@
+#include "GC.h"
+#include "HeapObject.h"
+
+void HeapObject::destroy()
+{
+    if ( m_generation != UNTRACKED )
+        GC::untrack( this );
+
+    delete this;
+}
\ No newline at end of file
@@ -0,0 +1,254 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "Pool.h"
+
+class HeapObject;
+class Object;
+
+template <typename T>
+class Ref;
+
+namespace GC
+{
+    void track( HeapObject* object );
+} // namespace GC
+
+// Passed to HeapObject::traverse() to enumerate the references an object
+// holds.
+class HeapVisitor
+{
+public:
+    virtual ~HeapVisitor() = default;
+    virtual void visit( HeapObject* object ) = 0;
+
+    void visit( const Object& value );
+
+    template <typename T>
+    void visit( const Ref<T>& object );
+};
+
+// Base of every Lox value that lives on the heap: strings, callables and
+// instances. Lifetimes are tracked with an intrusive, non-atomic reference
+// count so a value can refer to its object through a single raw pointer.
+// Objects that can hold references take part in cycle collection, see GC.h.
+class HeapObject
+{
+public:
+    enum class Kind : std::uint8_t
+    {
+        STRING,
+        INSTANCE,
+        ENVIRONMENT,
+        VM_UPVALUE,
+        CELL,
+
+        // Callables. Keep these last, isCallable() relies on the ordering.
+        FUNCTION,
+        CLASS,
+        NATIVE,
+        VM_CLOSURE,
+        VM_CLASS,
+        VM_BOUND_METHOD
+    };
+
+    explicit HeapObject( Kind kind ) : m_kind{ kind }
+    {
+    }
+
+    HeapObject( const HeapObject& ) = delete;
+    HeapObject& operator=( const HeapObject& ) = delete;
+    virtual ~HeapObject() = default;
+
+    // The virtual destructor makes delete pass the size of the most derived
+    // type, so every object goes back to the pool it came from.
+    static void* operator new( std::size_t size )
+    {
+        return Pool::allocate( size );
+    }
+
+    static void operator delete( void* object, std::size_t size )
+    {
+        Pool::deallocate( object, size );
+    }
+
+    Kind getKind() const
+    {
+        return m_kind;
+    }
+
+    bool isCallable() const
+    {
+        return m_kind >= Kind::FUNCTION;
+    }
+
+    // Strings and natives never refer to other objects, so they cannot be
+    // part of a cycle and the collector does not track them.
+    bool isContainer() const
+    {
+        return m_kind != Kind::STRING && m_kind != Kind::NATIVE;
+    }
+
+    // Visits every object this one holds a reference to, once per reference.
+    virtual void traverse( HeapVisitor& visitor ) const
+    {
+        static_cast<void>( visitor );
+    }
+
+    // Drops the references this object holds. The collector calls it to
+    // break cycles that are no longer reachable.
+    virtual void clear()
+    {
+    }
+
+    void retain()
+    {
+        ++m_refCount;
+    }
+
+    void release()
+    {
+        if ( --m_refCount == 0 )
+            destroy();
+    }
+
+private:
+    friend class Collector;
+
+    static constexpr std::uint8_t UNTRACKED = 0xff;
+
+    // Out of line so the common path of release() stays small, and so the
+    // compiler does not see a delete behind every value destructor.
+    void destroy();
+
+    std::uint32_t m_refCount{ 0 };
+    const Kind m_kind;
+
+    // Cycle collector bookkeeping: the generation list this object is on.
+    std::uint8_t m_generation{ UNTRACKED };
+    bool m_reachable{ false };
+    std::int32_t m_gcRefs{ 0 };
+    HeapObject* m_gcPrev{ nullptr };
+    HeapObject* m_gcNext{ nullptr };
+};
+
+// Owning handle to a HeapObject. It stores the base pointer, so a Ref<T> can
+// be copied and destroyed where T is only forward declared.
+template <typename T>
+class Ref
+{
+public:
+    Ref() = default;
+
+    Ref( std::nullptr_t )
+    {
+    }
+
+    explicit Ref( T* object ) : m_object{ object }
+    {
+        if ( m_object )
+            m_object->retain();
+    }
+
+    Ref( const Ref& other ) : m_object{ other.m_object }
+    {
+        if ( m_object )
+            m_object->retain();
+    }
+
+    Ref( Ref&& other ) noexcept : m_object{ other.m_object }
+    {
+        other.m_object = nullptr;
+    }
+
+    template <typename U,
+              typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    Ref( const Ref<U>& other ) : m_object{ other.m_object }
+    {
+        if ( m_object )
+            m_object->retain();
+    }
+
+    template <typename U,
+              typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    Ref( Ref<U>&& other ) noexcept : m_object{ other.m_object }
+    {
+        other.m_object = nullptr;
+    }
+
+    ~Ref()
+    {
+        if ( m_object )
+            m_object->release();
+    }
+
+    Ref& operator=( Ref other ) noexcept
+    {
+        std::swap( m_object, other.m_object );
+        return *this;
+    }
+
+    T* get() const
+    {
+        return static_cast<T*>( m_object );
+    }
+
+    T* operator->() const
+    {
+        return get();
+    }
+
+    T& operator*() const
+    {
+        return *get();
+    }
+
+    explicit operator bool() const
+    {
+        return m_object != nullptr;
+    }
+
+    HeapObject* getObject() const
+    {
+        return m_object;
+    }
+
+    friend bool operator==( const Ref& a, const Ref& b )
+    {
+        return a.m_object == b.m_object;
+    }
+
+    friend bool operator!=( const Ref& a, const Ref& b )
+    {
+        return a.m_object != b.m_object;
+    }
+
+private:
+    template <typename U>
+    friend class Ref;
+
+    HeapObject* m_object{ nullptr };
+};
+
+template <typename T>
+void HeapVisitor::visit( const Ref<T>& object )
+{
+    if ( object )
+        visit( object.getObject() );
+}
+
+template <typename T, typename... Args>
+Ref<T> makeRef( Args&&... args )
+{
+    Ref<T> object{ new T( std::forward<Args>( args )... ) };
+
+    // Tracking only starts once the object is fully built and owned, since
+    // it may trigger a collection.
+    if ( object->isContainer() )
+        GC::track( object.getObject() );
+
+    return object;
+}
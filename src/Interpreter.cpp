@@ -1,439 +1,717 @@
+#include <cstddef>
 #include <iostream>
+#include <iterator>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <variant>
 
 #include "Environment.h"
 #include "Error.h"
+#include "Completion.h"
 #include "Expression.h"
+#include "GC.h"
 #include "Interpreter.h"
+#include "Jit.h"
 #include "LoxCallable.h"
 #include "LoxClass.h"
 #include "LoxClock.h"
 #include "LoxFunction.h"
 #include "LoxInstance.h"
+#include "LoxString.h"
 #include "Object.h"
-#include "ReturnValue.h"
 #include "Statement.h"
+#include "Symbol.h"
 #include "Token.h"
 
 Interpreter::Interpreter()
 {
-    m_globals->define( "clock", Object{ std::make_shared<LoxClock>(
-                                    std::move( LoxClock{} ) ) } );
+    m_globals->define( Symbols::CLOCK, Object{ makeRef<LoxClock>() } );
 }
 
-void Interpreter::interpret(
-    const std::vector<std::unique_ptr<Stmt>>& statements )
+Interpreter::~Interpreter()
+{
+    // Functions that capture their own name hold the cell they are stored
+    // in, so they only go away with a collection. Compiled code holds the
+    // functions it calls.
+    Jit::release();
+    m_globals = nullptr;
+    GC::collect();
+}
+
+template <typename Statements>
+void Interpreter::interpretAll( const Statements& statements )
 {
     try
     {
         for ( auto&& statement : statements )
         {
-            execute( statement.get() );
+            execute( statement );
         }
     }
     catch ( const Error::RuntimeError& error )
     {
+        // Scopes clean up after themselves, but the top level leaves the
+        // arguments of the calls the error interrupted.
+        m_stack.clear();
         runtimeError( error );
     }
 }
 
-void Interpreter::visit( Assign* expr )
+void Interpreter::interpret( const NodeList<Stmt*>& statements )
 {
-    evaluate( expr->value.get() );
-    Object value = m_object;
+    interpretAll( statements );
+}
 
-    if ( m_locals.find( expr ) != m_locals.end() )
-    {
-        int distance = m_locals[expr];
-        m_environment->assignAt( distance, expr->name, value );
-    }
-    else
-    {
-        m_globals->assign( expr->name, value );
-    }
+void Interpreter::interpret( const std::vector<StmtCode>& program )
+{
+    interpretAll( program );
 }
 
-void Interpreter::visit( Binary* expr )
+Object Interpreter::visit( Assign* expr )
 {
-    evaluate( expr->left.get() );
-    Object left = m_object;
+    Object value = evaluate( expr->value );
 
-    evaluate( expr->right.get() );
-    Object right = m_object;
+    assignVariable( expr->name, expr->location, value );
+    return value;
+}
 
-    switch ( expr->op.getType() )
+Object Interpreter::visit( Binary* expr )
+{
+    Object left = evaluate( expr->left );
+    Object right = evaluate( expr->right );
+
+    switch ( expr->specialization )
     {
-    case TokenType::GREATER:
-        checkNumberOperands( expr->op, left, right );
-        m_object = std::get<double>( left ) > std::get<double>( right );
-        return;
-    case TokenType::GREATER_EQUAL:
-        checkNumberOperands( expr->op, left, right );
-        m_object = std::get<double>( left ) >= std::get<double>( right );
-        return;
-    case TokenType::LESS:
-        checkNumberOperands( expr->op, left, right );
-        m_object = std::get<double>( left ) < std::get<double>( right );
-        return;
-    case TokenType::LESS_EQUAL:
-        checkNumberOperands( expr->op, left, right );
-        m_object = std::get<double>( left ) <= std::get<double>( right );
-        return;
-    case TokenType::BANG_EQUAL:
-        m_object = !isEqual( left, right );
-        return;
-    case TokenType::EQUAL_EQUAL:
-        m_object = isEqual( left, right );
-        return;
-    case TokenType::MINUS:
-        checkNumberOperands( expr->op, left, right );
-        m_object = std::get<double>( left ) - std::get<double>( right );
-        return;
-    case TokenType::PLUS:
-        // Doubles
-        if ( left.index() == 2 && right.index() == 2 )
+    case Specialization::UNINITIALIZED:
+        expr->specialization = specialize( expr->op, left, right );
+        break;
+    case Specialization::GENERIC:
+        break;
+    case Specialization::STRING_CONCAT:
+        if ( left.isString() && right.isString() )
         {
-            m_object = std::get<double>( left ) + std::get<double>( right );
-            return;
+            return LoxString::concat( left.asRef<LoxString>(),
+                                      right.asRef<LoxString>() );
         }
-        // Strings
-        if ( left.index() == 1 && right.index() == 1 )
+        expr->specialization = Specialization::GENERIC;
+        break;
+    default:
+        if ( left.isNumber() && right.isNumber() )
         {
-            m_object =
-                std::get<std::string>( left ) + std::get<std::string>( right );
-            return;
+            return numberBinary( expr->specialization, left.asNumber(),
+                                 right.asNumber() );
         }
-
-        throw Error::RuntimeError{
-            expr->op, "Operands must be two numbers or two strings." };
-    case TokenType::SLASH:
-        checkNumberOperands( expr->op, left, right );
-        m_object = std::get<double>( left ) / std::get<double>( right );
-        return;
-    case TokenType::STAR:
-        checkNumberOperands( expr->op, left, right );
-        m_object = std::get<double>( left ) * std::get<double>( right );
-        return;
-    default:
-        m_object = std::monostate{};
-        return;
+        expr->specialization = Specialization::GENERIC;
+        break;
     }
+
+    return binary( expr, left, right );
 }
 
-void Interpreter::visit( Call* expr )
+Object Interpreter::visit( Call* expr )
 {
-    evaluate( expr->callee.get() );
-    Object callee = m_object;
-
-    std::vector<Object> arguments{};
-    for ( auto&& argument : expr->arguments )
-    {
-        evaluate( argument.get() );
-        arguments.push_back( m_object );
-    }
-
-    std::shared_ptr<LoxCallable> function;
-
-    if ( !std::holds_alternative<std::shared_ptr<LoxCallable>>( callee ) )
-    {
-        throw Error::RuntimeError{ expr->paren,
-                                   "Can only call functions and classes." };
-    }
-
-    function = std::get<std::shared_ptr<LoxCallable>>( callee );
-
-    if ( static_cast<int>( arguments.size() ) != function->arity() )
-    {
-        throw Error::RuntimeError{
-            expr->paren, "Expected " + std::to_string( function->arity() ) +
-                             " arguments but got " +
-                             std::to_string( arguments.size() ) + "." };
-    }
-
-    m_object = function->call( *this, arguments );
+    PendingCall call = evaluateCall( expr );
+    return makeCall( call );
 }
 
-void Interpreter::visit( Get* expr )
+Object Interpreter::visit( Get* expr )
 {
-    evaluate( expr->object.get() );
-    if ( std::holds_alternative<std::shared_ptr<LoxInstance>>( m_object ) )
+    Object object = evaluate( expr->object );
+    if ( object.isInstance() )
     {
-        m_object = std::get<std::shared_ptr<LoxInstance>>( m_object )
-                       ->get( expr->name );
-        return;
+        return object.as<LoxInstance>()->get( expr->name, expr->cache );
     }
 
     throw Error::RuntimeError{ expr->name, "Only instances have properties." };
 }
 
-void Interpreter::visit( Grouping* expr )
+Object Interpreter::visit( Grouping* expr )
 {
-    evaluate( expr->expr.get() );
+    return evaluate( expr->expr );
 }
 
-void Interpreter::visit( Literal* expr )
+Object Interpreter::visit( Literal* expr )
 {
-    m_object = expr->value;
+    return expr->value;
 }
 
-void Interpreter::visit( Logical* expr )
+Object Interpreter::visit( Logical* expr )
 {
-    evaluate( expr->left.get() );
-    Object left = m_object;
+    Object left = evaluate( expr->left );
 
     if ( expr->op.getType() == TokenType::OR )
     {
         if ( isTruthy( left ) )
-        {
-            m_object = left;
-            return;
-        }
+            return left;
     }
     else
     {
         if ( !isTruthy( left ) )
-        {
-            m_object = left;
-            return;
-        }
+            return left;
     }
 
-    evaluate( expr->right.get() );
+    return evaluate( expr->right );
 }
 
-void Interpreter::visit( Set* expr )
+Object Interpreter::visit( Set* expr )
 {
-    evaluate( expr->object.get() );
-    Object object = m_object;
+    Object object = evaluate( expr->object );
 
-    if ( !std::holds_alternative<std::shared_ptr<LoxInstance>>( object ) )
+    if ( !object.isInstance() )
     {
         throw Error::RuntimeError{ expr->name, "Only instances have fields." };
     }
 
-    evaluate( expr->value.get() );
-    Object value = m_object;
-    std::get<std::shared_ptr<LoxInstance>>( object ).get()->set( expr->name,
-                                                                 value );
+    Object value = evaluate( expr->value );
+    object.as<LoxInstance>()->set( expr->name, value, expr->cache );
+    return value;
 }
 
-void Interpreter::visit( Super* expr )
+Object Interpreter::visit( Super* expr )
 {
-    int distance = m_locals.at( expr );
-    std::shared_ptr<LoxClass> superclass = std::dynamic_pointer_cast<LoxClass>(
-        std::get<std::shared_ptr<LoxCallable>>(
-            m_environment->getAt( distance, "super" ) ) );
+    Object superclassObject = lookUpVariable( expr->keyword, expr->location );
+    LoxClass* superclass = superclassObject.as<LoxClass>();
+    Ref<LoxInstance> object =
+        lookUpVariable( expr->keyword, expr->thisLocation )
+            .asRef<LoxInstance>();
 
-    std::shared_ptr<LoxInstance> object =
-        std::get<std::shared_ptr<LoxInstance>>(
-            m_environment->getAt( distance = 1, "this" ) );
+    if ( expr->cachedClassId != superclass->getId() )
+    {
+        LoxFunction* method =
+            superclass->findMethod( expr->method.getSymbol() );
 
-    std::shared_ptr<LoxFunction> method =
-        superclass->findMethod( expr->method.getLexeme() );
+        if ( !method )
+            throw Error::RuntimeError{ expr->method,
+                                       "Undefined property '" +
+                                           expr->method.getLexeme() + "'." };
 
-    if ( !method.get() )
-        throw Error::RuntimeError{ expr->method, "Undefined property '" +
-                                                     expr->method.getLexeme() +
-                                                     "'." };
+        expr->cachedClassId = superclass->getId();
+        expr->cachedMethod = method;
+    }
 
-    m_object = method->bind( object );
+    return expr->cachedMethod->bind( object );
 }
 
-void Interpreter::visit( This* expr )
+Object Interpreter::visit( This* expr )
 {
-    m_object = lookUpVariable( expr->keyword, expr );
+    return lookUpVariable( expr->keyword, expr->location );
 }
 
-void Interpreter::visit( Unary* expr )
+Object Interpreter::visit( Unary* expr )
 {
-    evaluate( expr->right.get() );
+    Object right = evaluate( expr->right );
 
-    Object right = m_object;
+    switch ( expr->specialization )
+    {
+    case Specialization::NUMBER_NEGATE:
+        if ( right.isNumber() )
+            return -right.asNumber();
+        expr->specialization = Specialization::GENERIC;
+        break;
+    case Specialization::NOT:
+        return !isTruthy( right );
+    case Specialization::UNINITIALIZED:
+        if ( expr->op.getType() == TokenType::BANG )
+            expr->specialization = Specialization::NOT;
+        else if ( right.isNumber() )
+            expr->specialization = Specialization::NUMBER_NEGATE;
+        else
+            expr->specialization = Specialization::GENERIC;
+        break;
+    default:
+        break;
+    }
 
     switch ( expr->op.getType() )
     {
     case TokenType::BANG:
-        m_object = !isTruthy( right );
-        return;
+        return !isTruthy( right );
     case TokenType::MINUS:
         checkNumberOperand( expr->op, right );
-        m_object = -std::get<double>( right );
-        return;
+        return -right.asNumber();
     default:
-        m_object = std::monostate{};
-        return;
+        return std::monostate{};
     }
 }
 
-void Interpreter::visit( Variable* expr )
+Object Interpreter::visit( Variable* expr )
 {
-    m_object = lookUpVariable( expr->name, expr );
+    return lookUpVariable( expr->name, expr->location );
 }
 
-void Interpreter::visit( Block* stmt )
+Completion Interpreter::visit( Block* stmt )
 {
-    std::shared_ptr<Environment> env{ new Environment{ m_environment } };
-    executeBlock( stmt->statements, env );
+    return executeBlock( stmt->statements, m_stack.size() );
 }
 
-void Interpreter::visit( ClassStmt* stmt )
+Completion Interpreter::visit( ClassStmt* stmt )
 {
     Object superclass{ std::monostate{} };
-    std::shared_ptr<LoxCallable> temp = nullptr;
-    if ( stmt->superclass.get() )
+    Ref<LoxClass> temp = nullptr;
+    if ( stmt->superclass )
     {
-        evaluate( stmt->superclass.get() );
-        superclass = m_object;
-        if ( !( std::holds_alternative<std::shared_ptr<LoxCallable>>(
-                    superclass ) &&
-                dynamic_cast<LoxClass*>(
-                    std::get<std::shared_ptr<LoxCallable>>( superclass )
-                        .get() ) != nullptr ) )
+        superclass = evaluate( stmt->superclass );
+        if ( !superclass.isKind( HeapObject::Kind::CLASS ) )
         {
             throw Error::RuntimeError{ stmt->superclass->name,
                                        "Superclass must be a class." };
         }
         else
         {
-            temp = std::get<std::shared_ptr<LoxCallable>>( superclass );
+            temp = superclass.asRef<LoxClass>();
         }
     }
 
-    m_environment->define( stmt->name.getLexeme(), Object{ std::monostate{} } );
+    bool isGlobal = m_scopes.empty();
+    std::size_t slot = m_stack.size();
+    Ref<Cell> cell = nullptr;
+    if ( isGlobal )
+        m_globals->define( stmt->name.getSymbol(), Object{ std::monostate{} } );
+    else if ( stmt->captured )
+    {
+        cell = makeRef<Cell>( Object{ std::monostate{} } );
+        m_stack.push_back( Object{ cell } );
+    }
+    else
+        m_stack.push_back( Object{ std::monostate{} } );
 
-    if ( stmt->superclass.get() )
+    // Only methods refer to "super", so it is always captured. Creating the
+    // methods cannot fail, so the scope needs no unwinding.
+    if ( stmt->superclass )
     {
-        m_environment = std::make_shared<Environment>( m_environment );
-        m_environment->define( "super", temp );
+        m_scopes.push_back( m_stack.size() );
+        m_stack.push_back( Object{ makeRef<Cell>( Object{ temp } ) } );
     }
 
-    std::map<std::string, std::shared_ptr<LoxFunction>> methods;
+    std::unordered_map<Symbol, Ref<LoxFunction>> methods;
     for ( auto&& method : stmt->methods )
     {
-        std::shared_ptr<LoxFunction> function = std::make_shared<LoxFunction>(
-            method.get(), m_environment, method->name.getLexeme() == "init" );
-        methods.emplace( method.get()->name.getLexeme(), function );
+        bool isInitializer = method->name.getSymbol() == Symbols::INIT;
+        Ref<LoxFunction> function = makeRef<LoxFunction>(
+            method, captureUpvalues( method ), isInitializer );
+        methods.emplace( method->name.getSymbol(), function );
     }
 
-    std::shared_ptr<LoxClass> klass{
-        new LoxClass{ stmt->name.getLexeme(),
-                      std::dynamic_pointer_cast<LoxClass>( temp ), methods } };
+    Ref<LoxClass> klass = makeRef<LoxClass>( stmt->name.getLexeme(), temp,
+                                             std::move( methods ) );
 
-    if ( stmt->superclass.get() )
-        m_environment = m_environment->m_enclosing;
+    if ( stmt->superclass )
+        endScope();
+
+    if ( isGlobal )
+        m_globals->define( stmt->name.getSymbol(), Object{ klass } );
+    else if ( cell )
+        cell->value = Object{ klass };
+    else
+        m_stack[slot] = Object{ klass };
 
-    m_environment->assign( stmt->name, Object{ klass } );
+    return Completion::normal();
 }
 
-void Interpreter::visit( Expression* stmt )
+Completion Interpreter::visit( Expression* stmt )
 {
-    evaluate( stmt->expression.get() );
+    evaluate( stmt->expression );
+    return Completion::normal();
 }
 
-void Interpreter::visit( Function* stmt )
+Completion Interpreter::visit( Function* stmt )
 {
-    std::shared_ptr<LoxFunction> function{
-        new LoxFunction{ stmt, m_environment, false } };
-    m_environment->define( stmt->name.getLexeme(), Object{ function } );
+    if ( !stmt->captured )
+    {
+        define( stmt->name, Object{ makeRef<LoxFunction>(
+                                stmt, captureUpvalues( stmt ), false ) } );
+        return Completion::normal();
+    }
+
+    // A function that can see its own name captures the cell it is stored
+    // in, so the cell has to exist before the closure does.
+    Ref<Cell> cell = makeRef<Cell>( Object{ std::monostate{} } );
+    define( stmt->name, Object{ cell } );
+    cell->value = Object{ makeRef<LoxFunction>( stmt, captureUpvalues( stmt ),
+                                                false ) };
+    return Completion::normal();
 }
 
-void Interpreter::visit( If* stmt )
+Completion Interpreter::visit( If* stmt )
 {
-    evaluate( stmt->condition.get() );
-    if ( isTruthy( m_object ) )
+    if ( isTruthy( evaluate( stmt->condition ) ) )
     {
-        execute( stmt->thenBranch.get() );
+        return execute( stmt->thenBranch );
     }
-    else if ( stmt->elseBranch.get() )
+    else if ( stmt->elseBranch )
     {
-        execute( stmt->elseBranch.get() );
+        return execute( stmt->elseBranch );
     }
+
+    return Completion::normal();
 }
 
-void Interpreter::visit( Print* stmt )
+Completion Interpreter::visit( Print* stmt )
 {
-    evaluate( stmt->expression.get() );
-    std::cout << stringify( m_object ) << '\n';
+    printObject( std::cout, evaluate( stmt->expression ) );
+    std::cout << '\n';
+    return Completion::normal();
 }
 
-void Interpreter::visit( Return* stmt )
+Completion Interpreter::visit( Return* stmt )
 {
+    if ( stmt->tailCall )
+    {
+        setTailCall( evaluateCall( stmt->tailCall ) );
+        return Completion::tailCall();
+    }
+
     Object value{ std::monostate{} };
     if ( stmt->value != nullptr )
+        value = evaluate( stmt->value );
+
+    return Completion::returning( std::move( value ) );
+}
+
+Completion Interpreter::visit( Var* stmt )
+{
+    Object value = std::monostate{};
+    if ( stmt->initializer )
+        value = evaluate( stmt->initializer );
+
+    if ( stmt->captured )
+        define( stmt->name, Object{ makeRef<Cell>( value ) } );
+    else
+        define( stmt->name, value );
+    return Completion::normal();
+}
+
+Completion Interpreter::visit( While* stmt )
+{
+    while ( isTruthy( evaluate( stmt->condition ) ) )
     {
-        evaluate( stmt->value.get() );
-        value = m_object;
+        Completion completion = execute( stmt->body );
+        if ( completion.isReturn() )
+            return completion;
     }
 
-    throw ReturnValue{ value };
+    return Completion::normal();
 }
 
-void Interpreter::visit( Var* stmt )
+Object Interpreter::binary( Binary* expr, const Object& left,
+                            const Object& right )
 {
-    Object value = std::monostate{};
-    if ( stmt->initializer.get() )
+    switch ( expr->op.getType() )
     {
-        evaluate( stmt->initializer.get() );
-        value = m_object;
+    case TokenType::GREATER:
+        checkNumberOperands( expr->op, left, right );
+        return left.asNumber() > right.asNumber();
+    case TokenType::GREATER_EQUAL:
+        checkNumberOperands( expr->op, left, right );
+        return left.asNumber() >= right.asNumber();
+    case TokenType::LESS:
+        checkNumberOperands( expr->op, left, right );
+        return left.asNumber() < right.asNumber();
+    case TokenType::LESS_EQUAL:
+        checkNumberOperands( expr->op, left, right );
+        return left.asNumber() <= right.asNumber();
+    case TokenType::BANG_EQUAL:
+        return !isEqual( left, right );
+    case TokenType::EQUAL_EQUAL:
+        return isEqual( left, right );
+    case TokenType::MINUS:
+        checkNumberOperands( expr->op, left, right );
+        return left.asNumber() - right.asNumber();
+    case TokenType::PLUS:
+        // Doubles
+        if ( left.isNumber() && right.isNumber() )
+        {
+            return left.asNumber() + right.asNumber();
+        }
+        // Strings
+        if ( left.isString() && right.isString() )
+        {
+            return LoxString::concat( left.asRef<LoxString>(),
+                                      right.asRef<LoxString>() );
+        }
+
+        throw Error::RuntimeError{
+            expr->op, "Operands must be two numbers or two strings." };
+    case TokenType::SLASH:
+        checkNumberOperands( expr->op, left, right );
+        return left.asNumber() / right.asNumber();
+    case TokenType::STAR:
+        checkNumberOperands( expr->op, left, right );
+        return left.asNumber() * right.asNumber();
+    default:
+        return std::monostate{};
     }
+}
 
-    m_environment->define( stmt->name.getLexeme(), value );
+Specialization Interpreter::specialize( const Token& op, const Object& left,
+                                        const Object& right )
+{
+    if ( left.isString() && right.isString() )
+    {
+        return op.getType() == TokenType::PLUS ? Specialization::STRING_CONCAT
+                                                : Specialization::GENERIC;
+    }
+
+    if ( !left.isNumber() || !right.isNumber() )
+        return Specialization::GENERIC;
+
+    switch ( op.getType() )
+    {
+    case TokenType::PLUS:
+        return Specialization::NUMBER_ADD;
+    case TokenType::MINUS:
+        return Specialization::NUMBER_SUBTRACT;
+    case TokenType::STAR:
+        return Specialization::NUMBER_MULTIPLY;
+    case TokenType::SLASH:
+        return Specialization::NUMBER_DIVIDE;
+    case TokenType::GREATER:
+        return Specialization::NUMBER_GREATER;
+    case TokenType::GREATER_EQUAL:
+        return Specialization::NUMBER_GREATER_EQUAL;
+    case TokenType::LESS:
+        return Specialization::NUMBER_LESS;
+    case TokenType::LESS_EQUAL:
+        return Specialization::NUMBER_LESS_EQUAL;
+    case TokenType::EQUAL_EQUAL:
+        return Specialization::NUMBER_EQUAL;
+    case TokenType::BANG_EQUAL:
+        return Specialization::NUMBER_NOT_EQUAL;
+    default:
+        return Specialization::GENERIC;
+    }
 }
 
-void Interpreter::visit( While* stmt )
+Object Interpreter::numberBinary( Specialization specialization, double left,
+                                  double right )
 {
-    evaluate( stmt->condition.get() );
-    while ( isTruthy( m_object ) )
+    switch ( specialization )
     {
-        execute( stmt->body.get() );
-        evaluate( stmt->condition.get() );
+    case Specialization::NUMBER_ADD:
+        return left + right;
+    case Specialization::NUMBER_SUBTRACT:
+        return left - right;
+    case Specialization::NUMBER_MULTIPLY:
+        return left * right;
+    case Specialization::NUMBER_DIVIDE:
+        return left / right;
+    case Specialization::NUMBER_GREATER:
+        return left > right;
+    case Specialization::NUMBER_GREATER_EQUAL:
+        return left >= right;
+    case Specialization::NUMBER_LESS:
+        return left < right;
+    case Specialization::NUMBER_LESS_EQUAL:
+        return left <= right;
+    case Specialization::NUMBER_EQUAL:
+        return left == right;
+    case Specialization::NUMBER_NOT_EQUAL:
+        return left != right;
+    default:
+        return std::monostate{};
     }
 }
 
-void Interpreter::resolve( Expr* expr, int depth )
+Object Interpreter::evaluate( Expr* expr )
 {
-    m_locals[expr] = depth;
+    return expr->accept( this );
 }
 
-void Interpreter::evaluate( Expr* expr )
+Completion Interpreter::execute( Stmt* stmt )
 {
-    expr->accept( this );
+    return stmt->accept( this );
 }
 
-void Interpreter::execute( Stmt* stmt )
+Completion Interpreter::execute( const StmtCode& code )
 {
-    stmt->accept( this );
+    return code( *this );
 }
 
-void Interpreter::executeBlock(
-    const std::vector<std::unique_ptr<Stmt>>& statements,
-    std::shared_ptr<Environment> environment )
+Interpreter::PendingCall Interpreter::evaluateCall( Call* expr )
 {
-    std::shared_ptr<Environment> previous = m_environment;
+    PendingCall call{};
+
+    if ( Get* property = expr->property )
+        lookUpProperty( call, property, evaluate( property->object ) );
+    else
+        call.callee = evaluate( expr->callee );
 
+    call.arguments = beginArguments();
+    for ( auto&& argument : expr->arguments )
+    {
+        m_stack.push_back( evaluate( argument ) );
+    }
+
+    checkCallee( expr, call );
+    return call;
+}
+
+std::size_t Interpreter::beginArguments()
+{
+    m_stack.push_back( Object{ std::monostate{} } );
+    return m_stack.size();
+}
+
+Span<const Object> Interpreter::argumentsOf( const PendingCall& call )
+{
+    return Span<const Object>{ m_stack.data() + call.arguments,
+                               m_stack.size() - call.arguments };
+}
+
+void Interpreter::lookUpProperty( PendingCall& call, Get* property,
+                                  const Object& object )
+{
+    if ( !object.isInstance() )
+    {
+        throw Error::RuntimeError{ property->name,
+                                   "Only instances have properties." };
+    }
+
+    // Fields shadow methods, and a field holding a function is called like
+    // any other value.
+    LoxInstance* instance = object.as<LoxInstance>();
+    if ( Object* field = instance->findField( property->name.getSymbol(),
+                                              property->cache ) )
+    {
+        call.callee = *field;
+        return;
+    }
+
+    LoxFunction* method =
+        instance->getClass()->findMethod( property->name.getSymbol() );
+    if ( !method )
+    {
+        throw Error::RuntimeError{ property->name,
+                                   "Undefined property '" +
+                                       property->name.getLexeme() + "'." };
+    }
+
+    call.callee = Ref<LoxFunction>{ method };
+    call.receiver = object.asRef<LoxInstance>();
+}
+
+void Interpreter::checkCallee( Call* expr, const PendingCall& call )
+{
+    if ( !call.callee.isCallable() )
+    {
+        throw Error::RuntimeError{ expr->paren,
+                                   "Can only call functions and classes." };
+    }
+
+    checkArity( expr->paren, call.callee.as<LoxCallable>()->arity(),
+                m_stack.size() - call.arguments );
+}
+
+Object Interpreter::makeCall( PendingCall& call )
+{
+    // 'call' keeps the receiver alive for the duration of the call.
+    Object result =
+        call.receiver
+            ? call.callee.as<LoxFunction>()->invoke(
+                  *this, call.receiver.get(), argumentsOf( call ) )
+            : call.callee.as<LoxCallable>()->call( *this,
+                                                   argumentsOf( call ) );
+
+    m_stack.resize( call.arguments - 1 );
+    return result;
+}
+
+void Interpreter::setTailCall( PendingCall call )
+{
+    auto arguments =
+        m_stack.begin() + static_cast<std::ptrdiff_t>( call.arguments );
+    m_tailArguments.assign( std::make_move_iterator( arguments ),
+                            std::make_move_iterator( m_stack.end() ) );
+    m_stack.resize( call.arguments - 1 );
+    m_tailCall = std::move( call );
+}
+
+void Interpreter::checkArity( const Token& paren, int arity,
+                              std::size_t count )
+{
+    if ( static_cast<int>( count ) == arity )
+        return;
+
+    throw Error::RuntimeError{ paren, "Expected " + std::to_string( arity ) +
+                                          " arguments but got " +
+                                          std::to_string( count ) + "." };
+}
+
+template <typename Statements>
+Completion Interpreter::executeScope( const Statements& statements,
+                                      std::size_t scope,
+                                      const std::vector<Ref<Cell>>* upvalues )
+{
+    const std::vector<Ref<Cell>>* previousUpvalues = m_upvalues;
+    Completion completion = Completion::normal();
+
+    // Only runtime errors still unwind through here.
     try
     {
-        m_environment = environment;
+        m_scopes.push_back( scope );
+        if ( upvalues )
+            m_upvalues = upvalues;
 
         for ( auto&& statement : statements )
         {
-            execute( statement.get() );
+            completion = execute( statement );
+            if ( completion.isReturn() )
+                break;
         }
     }
     catch ( ... )
     {
-        m_environment = previous;
+        endScope();
+        m_upvalues = previousUpvalues;
         throw;
     }
 
-    m_environment = previous;
+    endScope();
+    m_upvalues = previousUpvalues;
+    return completion;
+}
+
+Completion Interpreter::executeBlock( const NodeList<Stmt*>& statements,
+                                      std::size_t scope,
+                                      const std::vector<Ref<Cell>>* upvalues )
+{
+    return executeScope( statements, scope, upvalues );
+}
+
+Completion Interpreter::executeBlock( const std::vector<StmtCode>& statements,
+                                      std::size_t scope,
+                                      const std::vector<Ref<Cell>>* upvalues )
+{
+    return executeScope( statements, scope, upvalues );
+}
+
+void Interpreter::endScope()
+{
+    m_stack.resize( m_scopes.back() );
+    m_scopes.pop_back();
+}
+
+Object& Interpreter::local( const Location& location )
+{
+    return local( static_cast<std::size_t>( location.depth ),
+                  static_cast<std::size_t>( location.slot ) );
+}
+
+void Interpreter::define( const Token& name, const Object& value )
+{
+    // Only the global scope is keyed by name; local declarations take the
+    // next slot, matching the order the Resolver numbered them in.
+    if ( m_scopes.empty() )
+        m_globals->define( name.getSymbol(), value );
+    else
+        m_stack.push_back( value );
 }
 
 void Interpreter::checkNumberOperand( const Token& op, const Object& operand )
 {
-    if ( operand.index() == 2 )
+    if ( operand.isNumber() )
         return;
 
     throw Error::RuntimeError{ op, "Operand must be a number." };
@@ -442,7 +720,7 @@ void Interpreter::checkNumberOperand( const Token& op, const Object& operand )
 void Interpreter::checkNumberOperands( const Token& op, const Object& left,
                                        const Object& right )
 {
-    if ( left.index() == 2 && right.index() == 2 )
+    if ( left.isNumber() && right.isNumber() )
         return;
 
     throw Error::RuntimeError{ op, "Operands must be numbers." };
@@ -450,63 +728,65 @@ void Interpreter::checkNumberOperands( const Token& op, const Object& left,
 
 bool Interpreter::isTruthy( const Object& object )
 {
-    if ( object.index() == 0 )
+    if ( object.isNil() )
         return false;
-    if ( object.index() == 3 )
-        return std::get<bool>( object );
+    if ( object.isBool() )
+        return object.asBool();
 
     return true;
 }
 
 bool Interpreter::isEqual( const Object& a, const Object& b )
 {
-    // Both null
-    if ( a.index() == 0 && b.index() == 0 )
-        return true;
-
-    // A or B is null
-    if ( a.index() == 0 || b.index() == 0 )
-        return false;
-
-    // Strings
-    if ( a.index() == 1 && b.index() == 1 )
-    {
-        return std::get<std::string>( a ) == std::get<std::string>( b );
-    }
+    // Nil, booleans, numbers and strings compare by value; callables and
+    // instances by identity.
+    return a == b;
+}
 
-    // Doubles
-    if ( a.index() == 2 && b.index() == 2 )
-    {
-        return std::get<double>( a ) == std::get<double>( b );
-    }
+Object Interpreter::lookUpVariable( const Token& name, Location& location )
+{
+    if ( location.isGlobal() )
+        return m_globals->get( name, global( name, location ) );
 
-    // Booleans
-    if ( a.index() == 3 && b.index() == 3 )
-    {
-        return std::get<bool>( a ) == std::get<bool>( b );
-    }
+    if ( location.isUpvalue() )
+        return ( *m_upvalues )[static_cast<std::size_t>( location.slot )]
+            ->value;
 
-    // None
-    return false;
+    const Object& value = local( location );
+    if ( location.captured )
+        return value.as<Cell>()->value;
+    return value;
 }
 
-std::string Interpreter::stringify( const Object& object )
+void Interpreter::assignVariable( const Token& name, Location& location,
+                                  const Object& value )
 {
-    if ( object.index() == 0 )
-        return "nil";
+    if ( location.isGlobal() )
+        m_globals->assign( name, global( name, location ), value );
+    else if ( location.isUpvalue() )
+        ( *m_upvalues )[static_cast<std::size_t>( location.slot )]->value =
+            value;
+    else if ( location.captured )
+        local( location ).as<Cell>()->value = value;
     else
-        return objectToString( object );
+        local( location ) = value;
 }
 
-Object Interpreter::lookUpVariable( const Token& name, Expr* expr )
+std::vector<Ref<Cell>> Interpreter::captureUpvalues( Function* function )
 {
-    if ( m_locals.find( expr ) != m_locals.end() )
+    // Captures are located as seen from where the function is declared,
+    // which is where this runs.
+    std::vector<Ref<Cell>> upvalues;
+    upvalues.reserve( function->captures.size() );
+    for ( const Location& capture : function->captures )
     {
-        int distance = m_locals[expr];
-        return m_environment->getAt( distance, name.getLexeme() );
-    }
-    else
-    {
-        return m_globals->get( name );
+        if ( capture.isUpvalue() )
+            upvalues.push_back(
+                ( *m_upvalues )[static_cast<std::size_t>( capture.slot )] );
+        else
+            upvalues.push_back(
+                local( capture ).asRef<Cell>() );
     }
+
+    return upvalues;
 }
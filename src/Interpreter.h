@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 
+#include "ClosureCompiler.h"
+#include "Completion.h"
 #include "Environment.h"
 #include "Error.h"
 #include "Expression.h"
@@ -13,59 +15,157 @@
 #include "Token.h"
 #include "Visitor.h"
 
-class Interpreter : public IVisitor
+class Interpreter : public ICompletionVisitor, public IValueVisitor
 {
 public:
+    friend class ClosureCompiler;
     friend class LoxFunction;
 
     Interpreter();
+    ~Interpreter();
 
-    void interpret( const std::vector<std::unique_ptr<Stmt>>& statements );
-    void visit( Assign* expr ) override;
-    void visit( Binary* expr ) override;
-    void visit( Call* expr ) override;
-    void visit( Get* expr ) override;
-    void visit( Grouping* expr ) override;
-    void visit( Literal* expr ) override;
-    void visit( Logical* expr ) override;
-    void visit( Set* expr ) override;
-    void visit( Super* expr ) override;
-    void visit( This* expr ) override;
-    void visit( Unary* expr ) override;
-    void visit( Variable* expr ) override;
-
-    void visit( Block* stmt ) override;
-    void visit( ClassStmt* stmt ) override;
-    void visit( Expression* stmt ) override;
-    void visit( Function* stmt ) override;
-    void visit( If* stmt ) override;
-    void visit( Print* stmt ) override;
-    void visit( Return* Stmt ) override;
-    void visit( Var* stmt ) override;
-    void visit( While* stmt ) override;
-
-    void resolve( Expr* expr, int depth );
-
-    friend Object LoxFunction::call( Interpreter& interpreter,
-                                     const std::vector<Object>& arguments );
+    void interpret( const NodeList<Stmt*>& statements );
+
+    // Runs a program compiled by the ClosureCompiler.
+    void interpret( const std::vector<StmtCode>& program );
+
+    Object visit( Assign* expr ) override;
+    Object visit( Binary* expr ) override;
+    Object visit( Call* expr ) override;
+    Object visit( Get* expr ) override;
+    Object visit( Grouping* expr ) override;
+    Object visit( Literal* expr ) override;
+    Object visit( Logical* expr ) override;
+    Object visit( Set* expr ) override;
+    Object visit( Super* expr ) override;
+    Object visit( This* expr ) override;
+    Object visit( Unary* expr ) override;
+    Object visit( Variable* expr ) override;
+
+    Completion visit( Block* stmt ) override;
+    Completion visit( ClassStmt* stmt ) override;
+    Completion visit( Expression* stmt ) override;
+    Completion visit( Function* stmt ) override;
+    Completion visit( If* stmt ) override;
+    Completion visit( Print* stmt ) override;
+    Completion visit( Return* stmt ) override;
+    Completion visit( Var* stmt ) override;
+    Completion visit( While* stmt ) override;
+
+    friend Object LoxFunction::invoke( Interpreter& interpreter,
+                                       LoxInstance* receiver,
+                                       Span<const Object> arguments );
 
 private:
-    void evaluate( Expr* expr );
-    void execute( Stmt* stmt );
+    // Runs the top-level statements of either kind of program.
+    template <typename Statements>
+    void interpretAll( const Statements& statements );
+
+    Object evaluate( Expr* expr );
+    Completion execute( Stmt* stmt );
+    Completion execute( const StmtCode& code );
+
+    // The generic path of a Binary node, taken until it specializes and
+    // again once its guard fails.
+    Object binary( Binary* expr, const Object& left, const Object& right );
+    Specialization specialize( const Token& op, const Object& left,
+                               const Object& right );
+    Object numberBinary( Specialization specialization, double left,
+                         double right );
+
+    // A call whose callee and arguments have been evaluated and checked.
+    // Methods called directly keep their receiver apart, so no bound
+    // method is created for them. The arguments are the top of the frame
+    // stack from index 'arguments' on, and the slot below them is left free
+    // for the receiver.
+    struct PendingCall
+    {
+        Object callee{};
+        Ref<LoxInstance> receiver{};
+        std::size_t arguments{ 0 };
+    };
+
+    PendingCall evaluateCall( Call* expr );
+
+    // Reserves the receiver's slot, and returns where the arguments that
+    // are pushed next start.
+    std::size_t beginArguments();
+    Span<const Object> argumentsOf( const PendingCall& call );
+
+    // Makes 'call' take the method or field 'property' names on 'object'.
+    void lookUpProperty( PendingCall& call, Get* property,
+                         const Object& object );
 
-    void executeBlock( const std::vector<std::unique_ptr<Stmt>>& statements,
-                       std::shared_ptr<Environment> environment );
+    // Checks that what 'expr' calls is callable with its arguments.
+    void checkCallee( Call* expr, const PendingCall& call );
+
+    // Makes the call and pops its arguments.
+    Object makeCall( PendingCall& call );
+
+    // Leaves 'call' for the function that is returning to make. Its
+    // arguments are set aside, since the returning frame is popped first.
+    void setTailCall( PendingCall call );
+    void checkArity( const Token& paren, int arity, std::size_t count );
+
+    // Runs the statements in a scope that starts at index 'scope' of the
+    // frame stack, and drops the scope's values afterwards. A function body
+    // has its receiver and arguments pushed already, and also passes the
+    // upvalues of the function it belongs to.
+    Completion executeBlock(
+        const NodeList<Stmt*>& statements, std::size_t scope,
+        const std::vector<Ref<Cell>>* upvalues = nullptr );
+    Completion executeBlock(
+        const std::vector<StmtCode>& statements, std::size_t scope,
+        const std::vector<Ref<Cell>>* upvalues = nullptr );
+    template <typename Statements>
+    Completion executeScope( const Statements& statements, std::size_t scope,
+                             const std::vector<Ref<Cell>>* upvalues );
+    void endScope();
+    Object& local( const Location& location );
+
+    Object& local( std::size_t depth, std::size_t slot )
+    {
+        return m_stack[m_scopes[m_scopes.size() - 1 - depth] + slot];
+    }
+
+    void define( const Token& name, const Object& value );
     void checkNumberOperand( const Token& op, const Object& operand );
     void checkNumberOperands( const Token& op, const Object& left,
                               const Object& right );
     bool isTruthy( const Object& object );
     bool isEqual( const Object& a, const Object& b );
-    std::string stringify( const Object& object );
 
-    Object lookUpVariable( const Token& name, Expr* expr );
+    Object lookUpVariable( const Token& name, Location& location );
+    void assignVariable( const Token& name, Location& location,
+                         const Object& value );
+
+    // The index of the global 'name' refers to, bound on first use.
+    std::size_t global( const Token& name, Location& location )
+    {
+        if ( location.global == Location::UNBOUND )
+            location.global = static_cast<std::uint32_t>(
+                m_globals->indexOf( name.getSymbol() ) );
+        return location.global;
+    }
+    std::vector<Ref<Cell>> captureUpvalues( Function* function );
+
+    Ref<Environment> m_globals{ makeRef<Environment>() };
+
+    // Locals of every active call and block, in declaration order, and the
+    // index at which each open scope starts. A Location is resolved within
+    // the current function, so it never reaches past the function's own
+    // scopes. Closures capture cells rather than scopes, so nothing refers
+    // to a scope once it ends and its values are simply popped.
+    std::vector<Object> m_stack{};
+    std::vector<std::size_t> m_scopes{};
+
+    // The upvalues of the function whose body is running, or nullptr at
+    // the top level, where there is nothing to capture from.
+    const std::vector<Ref<Cell>>* m_upvalues{ nullptr };
 
-    Object m_object{};
-    std::shared_ptr<Environment> m_globals{ new Environment{} };
-    std::shared_ptr<Environment> m_environment = m_globals;
-    std::map<Expr*, int> m_locals{};
+    // The call a TAIL_CALL completion left for LoxFunction::invoke to make,
+    // and its arguments. The vector is reused, so a tail call allocates
+    // nothing once it has grown to fit.
+    PendingCall m_tailCall{};
+    std::vector<Object> m_tailArguments{};
 };
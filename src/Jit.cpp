@@ -0,0 +1,920 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined( __x86_64__ ) && defined( __unix__ ) && defined( CPPLOX_NAN_BOXING )
+#define CPPLOX_JIT
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "Assembler.h"
+#include "Environment.h"
+#include "Expression.h"
+#include "Jit.h"
+#include "LoxFunction.h"
+#include "Statement.h"
+#include "Token.h"
+#include "Visitor.h"
+
+namespace
+{
+    using Register = Assembler::Register;
+    using Xmm = Assembler::Xmm;
+    using Condition = Assembler::Condition;
+    using Label = Assembler::Label;
+
+    std::vector<std::unique_ptr<Jit::Code>> codes{};
+
+    // The lowest address compiled code may grow the stack to. Only the
+    // interpreter enters compiled code, so it is set on every entry.
+    std::uint64_t stackLimit{ 0 };
+
+    // The functions being compiled, outermost first.
+    std::vector<Function*> compiling{};
+
+    // Parameters are copied out of the argument array into the frame, which
+    // holds the result pointer at rbp - 8 and then one slot per local or
+    // temporary.
+    std::int32_t slotOffset( std::size_t slot )
+    {
+        return -16 - static_cast<std::int32_t>( 8 * slot );
+    }
+
+    std::uint64_t bitsOf( double value )
+    {
+        std::uint64_t bits;
+        std::memcpy( &bits, &value, sizeof( bits ) );
+        return bits;
+    }
+
+    std::uint64_t addressOf( const void* pointer )
+    {
+        return static_cast<std::uint64_t>(
+            reinterpret_cast<std::uintptr_t>( pointer ) );
+    }
+
+    Jit::Code* compile( Function* function, Environment& globals );
+
+    // Generates the code of one function. Values are unboxed doubles in
+    // xmm0, with booleans as 0.0 and 1.0; which one a value is, is known
+    // while compiling. Locals and temporaries share numbered slots in the
+    // frame: a declaration takes the next slot, exactly as the Resolver
+    // numbered them, and temporaries are only ever live above the locals.
+    class FunctionCompiler : public IVisitor
+    {
+    public:
+        enum class Type
+        {
+            NUMBER,
+            BOOL
+        };
+
+        FunctionCompiler( Function* function, Environment& globals,
+                          Type returnType )
+            : m_function{ function }, m_globals{ globals },
+              m_returnType{ returnType }
+        {
+        }
+
+        // Returns false with getProblem() set if the function cannot be
+        // compiled.
+        bool compile()
+        {
+            m_asm.bind( m_entry );
+            m_asm.push( Register::RBP );
+            m_asm.mov( Register::RBP, Register::RSP );
+            std::size_t frameSize = m_asm.subWithPatch( Register::RSP );
+            m_asm.store( Register::RBP, -8, Register::RSI );
+
+            // Checked once the frame is allocated, so however large frames
+            // are, the stack ends up at most one frame past the limit.
+            m_asm.mov( Register::RAX, addressOf( &stackLimit ) );
+            m_asm.load( Register::RAX, Register::RAX, 0 );
+            m_asm.cmp( Register::RSP, Register::RAX );
+            m_asm.jump( Condition::BELOW, m_bailout );
+
+            beginScope();
+            for ( std::size_t i = 0; i < m_function->params.size(); ++i )
+            {
+                m_asm.movsd( Xmm::XMM0, Register::RDI,
+                             static_cast<std::int32_t>( 8 * i ) );
+                std::size_t slot = declare( Type::NUMBER );
+                m_asm.movsd( Register::RBP, slotOffset( slot ), Xmm::XMM0 );
+            }
+
+            m_asm.bind( m_body );
+            for ( auto&& statement : m_function->body )
+            {
+                statement->accept( this );
+            }
+            endScope();
+
+            // Falling off the end returns nil, which compiled code cannot.
+            m_asm.jump( m_bailout );
+
+            m_asm.bind( m_return );
+            m_asm.load( Register::RAX, Register::RBP, -8 );
+            m_asm.movsd( Register::RAX, 0, Xmm::XMM0 );
+            m_asm.mov( Register::RAX, std::uint64_t{ 1 } );
+            m_asm.jump( m_exit );
+
+            m_asm.bind( m_bailout );
+            m_asm.mov( Register::RAX, std::uint64_t{ 0 } );
+
+            m_asm.bind( m_exit );
+            m_asm.mov( Register::RSP, Register::RBP );
+            m_asm.pop( Register::RBP );
+            m_asm.ret();
+
+            std::size_t bytes = 8 + 8 * m_maxSlots;
+            m_asm.patch32( frameSize,
+                           static_cast<std::int32_t>( ( bytes + 15 ) & ~15u ) );
+
+            if ( !m_problem && !m_returns )
+                reject( "never returns a value" );
+            if ( !m_problem && m_selfCalled && m_returnType != m_selfType )
+            {
+                m_wrongReturnType = true;
+                reject( "returns a boolean from a recursive call" );
+            }
+
+            return !m_problem;
+        }
+
+        const char* getProblem() const
+        {
+            return m_problem;
+        }
+
+        Type getReturnType() const
+        {
+            return m_returnType;
+        }
+
+        // Recursive calls take the return type given to the constructor,
+        // which has to be tried again if the returns disagree with it or a
+        // value of the wrong type turns up after such a call.
+        bool assumedWrongReturnType() const
+        {
+            return m_wrongReturnType;
+        }
+
+        const Assembler& getAssembler() const
+        {
+            return m_asm;
+        }
+
+        std::vector<Object>& getCallees()
+        {
+            return m_callees;
+        }
+
+        void visit( Block* stmt ) override
+        {
+            beginScope();
+            for ( auto&& statement : stmt->statements )
+            {
+                statement->accept( this );
+            }
+            endScope();
+        }
+
+        void visit( ClassStmt* ) override
+        {
+            reject( "declares a class" );
+        }
+
+        void visit( Expression* stmt ) override
+        {
+            stmt->expression->accept( this );
+        }
+
+        void visit( Function* ) override
+        {
+            reject( "declares a function" );
+        }
+
+        void visit( If* stmt ) override
+        {
+            Label elseBranch{};
+            Label end{};
+            condition( stmt->condition, elseBranch );
+            stmt->thenBranch->accept( this );
+            if ( stmt->elseBranch )
+                m_asm.jump( end );
+            m_asm.bind( elseBranch );
+            if ( stmt->elseBranch )
+                stmt->elseBranch->accept( this );
+            m_asm.bind( end );
+        }
+
+        void visit( Print* ) override
+        {
+            reject( "prints" );
+        }
+
+        void visit( Return* stmt ) override
+        {
+            if ( !stmt->value )
+                return reject( "returns nil" );
+
+            // A recursive call in tail position reuses the frame.
+            if ( stmt->tailCall && lookUp( stmt->tailCall ) == m_function )
+            {
+                Arguments arguments = evaluateArguments( stmt->tailCall );
+                guard( stmt->tailCall );
+                for ( std::size_t i = 0; i < m_function->params.size(); ++i )
+                {
+                    m_asm.movsd( Xmm::XMM0, Register::RBP,
+                                 slotOffset( arguments.slot( i ) ) );
+                    m_asm.movsd( Register::RBP, slotOffset( i ), Xmm::XMM0 );
+                }
+                release( arguments.first );
+                m_asm.jump( m_body );
+                return;
+            }
+
+            stmt->value->accept( this );
+            if ( m_returns && m_type != m_returnType )
+                return mismatch( "returns both numbers and booleans" );
+
+            m_returnType = m_type;
+            m_returns = true;
+            m_asm.jump( m_return );
+        }
+
+        void visit( Var* stmt ) override
+        {
+            if ( !stmt->initializer )
+                return reject( "declares a variable without a value" );
+
+            stmt->initializer->accept( this );
+            m_asm.movsd( Register::RBP, slotOffset( declare( m_type ) ),
+                         Xmm::XMM0 );
+        }
+
+        void visit( While* stmt ) override
+        {
+            Label top{};
+            Label end{};
+            m_asm.bind( top );
+            condition( stmt->condition, end );
+            stmt->body->accept( this );
+            m_asm.jump( top );
+            m_asm.bind( end );
+        }
+
+        void visit( Assign* expr ) override
+        {
+            if ( !isLocal( expr->location ) )
+                return reject( "assigns a variable that is not its own" );
+
+            expr->value->accept( this );
+            std::size_t slot = local( expr->location );
+            if ( m_type != m_locals[slot] )
+                return mismatch( "changes the type of a variable" );
+
+            m_asm.movsd( Register::RBP, slotOffset( slot ), Xmm::XMM0 );
+        }
+
+        void visit( Binary* expr ) override
+        {
+            TokenType::Type op = expr->op.getType();
+            auto [left, right] = operands( expr->left, expr->right );
+
+            if ( op == TokenType::EQUAL_EQUAL || op == TokenType::BANG_EQUAL )
+            {
+                if ( left != right )
+                    return mismatch( "compares values of different types" );
+
+                // Unordered operands (NaN) are never equal.
+                m_asm.ucomisd( Xmm::XMM0, Xmm::XMM1 );
+                if ( op == TokenType::EQUAL_EQUAL )
+                {
+                    m_asm.setcc( Condition::EQUAL, Register::RAX );
+                    m_asm.setcc( Condition::NOT_PARITY, Register::RCX );
+                    m_asm.andByte( Register::RAX, Register::RCX );
+                }
+                else
+                {
+                    m_asm.setcc( Condition::NOT_EQUAL, Register::RAX );
+                    m_asm.setcc( Condition::PARITY, Register::RCX );
+                    m_asm.orByte( Register::RAX, Register::RCX );
+                }
+                return boolean();
+            }
+
+            if ( left != Type::NUMBER || right != Type::NUMBER )
+                return mismatch( "applies an operator to a boolean" );
+
+            m_type = Type::NUMBER;
+            switch ( op )
+            {
+            case TokenType::PLUS:
+                m_asm.addsd( Xmm::XMM0, Xmm::XMM1 );
+                return;
+            case TokenType::MINUS:
+                m_asm.subsd( Xmm::XMM0, Xmm::XMM1 );
+                return;
+            case TokenType::STAR:
+                m_asm.mulsd( Xmm::XMM0, Xmm::XMM1 );
+                return;
+            case TokenType::SLASH:
+                m_asm.divsd( Xmm::XMM0, Xmm::XMM1 );
+                return;
+            default:
+                m_asm.setcc( compare( op ), Register::RAX );
+                return boolean();
+            }
+        }
+
+        void visit( Call* expr ) override
+        {
+            Function* function = lookUp( expr );
+            if ( !function )
+                return reject( "calls something other than a global function "
+                               "with matching arity" );
+
+            Type type = Type::NUMBER;
+            if ( function == m_function )
+            {
+                type = m_selfType;
+                m_selfCalled = true;
+            }
+            else if ( !function->jitCode )
+            {
+                if ( function->jitFailed ||
+                     std::find( compiling.begin(), compiling.end(),
+                                function ) != compiling.end() ||
+                     !::compile( function, m_globals ) )
+                    return reject( "calls a function that is not compiled" );
+            }
+
+            if ( function != m_function && function->jitCode->returnsBool )
+                type = Type::BOOL;
+
+            // The callee copies its arguments into its own frame before
+            // anything else, so the result can go over the first of them.
+            Arguments arguments = evaluateArguments( expr );
+            guard( expr );
+            std::size_t first = arguments.slot( 0 );
+            m_asm.lea( Register::RDI, Register::RBP, slotOffset( first ) );
+            m_asm.mov( Register::RSI, Register::RDI );
+            if ( function == m_function )
+            {
+                m_asm.call( m_entry );
+            }
+            else
+            {
+                m_asm.mov( Register::RAX,
+                           addressOf( reinterpret_cast<const void*>(
+                               function->jitCode->entry ) ) );
+                m_asm.call( Register::RAX );
+            }
+            m_asm.test( Register::RAX, Register::RAX );
+            m_asm.jump( Condition::EQUAL, m_bailout );
+            m_asm.movsd( Xmm::XMM0, Register::RBP, slotOffset( first ) );
+            release( arguments.first );
+            m_type = type;
+        }
+
+        void visit( Get* ) override
+        {
+            reject( "uses an object" );
+        }
+
+        void visit( Grouping* expr ) override
+        {
+            expr->expr->accept( this );
+        }
+
+        void visit( Literal* expr ) override
+        {
+            if ( expr->value.isNumber() )
+            {
+                constant( Xmm::XMM0, expr->value.asNumber() );
+                m_type = Type::NUMBER;
+            }
+            else if ( expr->value.isBool() )
+            {
+                constant( Xmm::XMM0, expr->value.asBool() ? 1.0 : 0.0 );
+                m_type = Type::BOOL;
+            }
+            else
+            {
+                reject( "uses a value that is not a number or boolean" );
+            }
+        }
+
+        void visit( Logical* expr ) override
+        {
+            // The operand that decides the outcome is the result, so both
+            // have to be booleans for it to have a known type.
+            Label end{};
+            expr->left->accept( this );
+            if ( m_type != Type::BOOL )
+                return mismatch( "uses a number as a logical operand" );
+
+            m_asm.movq( Register::RAX, Xmm::XMM0 );
+            m_asm.test( Register::RAX, Register::RAX );
+            m_asm.jump( expr->op.getType() == TokenType::OR
+                            ? Condition::NOT_EQUAL
+                            : Condition::EQUAL,
+                        end );
+
+            expr->right->accept( this );
+            if ( m_type != Type::BOOL )
+                return mismatch( "uses a number as a logical operand" );
+            m_asm.bind( end );
+        }
+
+        void visit( Set* ) override
+        {
+            reject( "uses an object" );
+        }
+
+        void visit( Super* ) override
+        {
+            reject( "uses an object" );
+        }
+
+        void visit( This* ) override
+        {
+            reject( "uses an object" );
+        }
+
+        void visit( Unary* expr ) override
+        {
+            expr->right->accept( this );
+
+            if ( expr->op.getType() == TokenType::MINUS )
+            {
+                if ( m_type != Type::NUMBER )
+                    return mismatch( "negates a boolean" );
+
+                m_asm.mov( Register::RAX, std::uint64_t{ 1 } << 63 );
+                m_asm.movq( Xmm::XMM1, Register::RAX );
+                m_asm.xorpd( Xmm::XMM0, Xmm::XMM1 );
+                return;
+            }
+
+            // Numbers are always truthy.
+            if ( m_type == Type::NUMBER )
+            {
+                constant( Xmm::XMM0, 0.0 );
+                m_type = Type::BOOL;
+                return;
+            }
+
+            m_asm.movq( Register::RAX, Xmm::XMM0 );
+            m_asm.test( Register::RAX, Register::RAX );
+            m_asm.setcc( Condition::EQUAL, Register::RAX );
+            boolean();
+        }
+
+        void visit( Variable* expr ) override
+        {
+            if ( !isLocal( expr->location ) )
+                return reject( "reads a variable that is not its own" );
+
+            std::size_t slot = local( expr->location );
+            m_asm.movsd( Xmm::XMM0, Register::RBP, slotOffset( slot ) );
+            m_type = m_locals[slot];
+        }
+
+    private:
+        // Consecutive slots holding a call's arguments, laid out so that
+        // argument i is at the lowest address plus 8 * i. There is always
+        // at least one, to hold the result.
+        struct Arguments
+        {
+            std::size_t first;
+            std::size_t count;
+
+            std::size_t slot( std::size_t index ) const
+            {
+                return first + count - 1 - index;
+            }
+        };
+
+        void reject( const char* problem )
+        {
+            if ( !m_problem )
+                m_problem = problem;
+        }
+
+        // Rejects code that uses values of the wrong type. Once the function
+        // has called itself, a value may have the assumed type of that call,
+        // so the type is worth trying the other way around.
+        void mismatch( const char* problem )
+        {
+            if ( !m_problem && m_selfCalled )
+                m_wrongReturnType = true;
+            reject( problem );
+        }
+
+        void beginScope()
+        {
+            m_scopes.push_back( m_locals.size() );
+        }
+
+        void endScope()
+        {
+            m_locals.resize( m_scopes.back() );
+            m_slots = m_locals.size();
+            m_scopes.pop_back();
+        }
+
+        std::size_t declare( Type type )
+        {
+            m_locals.push_back( type );
+            return reserve( 1 );
+        }
+
+        // Temporaries are taken and released in stack order.
+        std::size_t reserve( std::size_t count )
+        {
+            std::size_t first = m_slots;
+            m_slots += count;
+            m_maxSlots = std::max( m_maxSlots, m_slots );
+            return first;
+        }
+
+        void release( std::size_t first )
+        {
+            m_slots = first;
+        }
+
+        bool isLocal( const Location& location ) const
+        {
+            return !location.isGlobal() && !location.isUpvalue() &&
+                   !location.captured;
+        }
+
+        std::size_t local( const Location& location ) const
+        {
+            return m_scopes[m_scopes.size() - 1 -
+                            static_cast<std::size_t>( location.depth )] +
+                   static_cast<std::size_t>( location.slot );
+        }
+
+        const Object* global( Call* expr ) const
+        {
+            Variable* variable = dynamic_cast<Variable*>( expr->callee );
+            if ( expr->property || !variable ||
+                 !variable->location.isGlobal() )
+                return nullptr;
+
+            return m_globals.find( variable->name.getSymbol() );
+        }
+
+        // The function a call refers to, if compiled code can call it.
+        Function* lookUp( Call* expr ) const
+        {
+            const Object* callee = global( expr );
+            if ( !callee || !callee->isKind( HeapObject::Kind::FUNCTION ) ||
+                 !callee->as<LoxFunction>()->isStandalone() )
+                return nullptr;
+
+            Function* function = callee->as<LoxFunction>()->getDeclaration();
+            if ( function->params.size() != expr->arguments.size() )
+                return nullptr;
+            return function;
+        }
+
+        // Bails out unless the global a call goes through still holds the
+        // function it held when the call was compiled.
+        void guard( Call* expr )
+        {
+            const Object* callee = global( expr );
+            m_callees.push_back( *callee );
+
+#ifdef CPPLOX_JIT
+            // A value is one 64-bit word, which for a function is its tagged
+            // pointer.
+            std::uint64_t bits;
+            static_assert( sizeof( Object ) == sizeof( bits ) );
+            std::memcpy( &bits, static_cast<const void*>( callee ),
+                         sizeof( bits ) );
+
+            m_asm.mov( Register::RAX, addressOf( callee ) );
+            m_asm.load( Register::RAX, Register::RAX, 0 );
+            m_asm.mov( Register::RCX, bits );
+            m_asm.cmp( Register::RAX, Register::RCX );
+            m_asm.jump( Condition::NOT_EQUAL, m_bailout );
+#endif
+        }
+
+        Arguments evaluateArguments( Call* expr )
+        {
+            std::size_t count =
+                std::max<std::size_t>( expr->arguments.size(), 1 );
+            Arguments arguments{ reserve( count ), count };
+            for ( std::size_t i = 0; i < expr->arguments.size(); ++i )
+            {
+                expr->arguments[static_cast<std::uint32_t>( i )]->accept(
+                    this );
+                if ( m_type != Type::NUMBER )
+                    mismatch( "passes a boolean argument" );
+
+                m_asm.movsd( Register::RBP, slotOffset( arguments.slot( i ) ),
+                             Xmm::XMM0 );
+            }
+            return arguments;
+        }
+
+        // Leaves the left operand in xmm0 and the right one in xmm1.
+        std::pair<Type, Type> operands( Expr* leftExpr, Expr* rightExpr )
+        {
+            leftExpr->accept( this );
+            Type left = m_type;
+
+            // Locals and constants go straight to xmm1.
+            Variable* variable = dynamic_cast<Variable*>( rightExpr );
+            Literal* literal = dynamic_cast<Literal*>( rightExpr );
+            if ( variable && isLocal( variable->location ) )
+            {
+                std::size_t slot = local( variable->location );
+                m_asm.movsd( Xmm::XMM1, Register::RBP, slotOffset( slot ) );
+                return { left, m_locals[slot] };
+            }
+            if ( literal && literal->value.isNumber() )
+            {
+                constant( Xmm::XMM1, literal->value.asNumber() );
+                return { left, Type::NUMBER };
+            }
+
+            std::size_t temporary = reserve( 1 );
+            m_asm.movsd( Register::RBP, slotOffset( temporary ), Xmm::XMM0 );
+            rightExpr->accept( this );
+            m_asm.movapd( Xmm::XMM1, Xmm::XMM0 );
+            m_asm.movsd( Xmm::XMM0, Register::RBP, slotOffset( temporary ) );
+            release( temporary );
+            return { left, m_type };
+        }
+
+        // Emits ucomisd for an ordering operator on xmm0 and xmm1, and
+        // returns the condition under which it holds. Operands are swapped
+        // for < and <= so that unordered operands compare false, as they do
+        // in C++.
+        Condition compare( TokenType::Type op )
+        {
+            switch ( op )
+            {
+            case TokenType::GREATER:
+                m_asm.ucomisd( Xmm::XMM0, Xmm::XMM1 );
+                return Condition::ABOVE;
+            case TokenType::GREATER_EQUAL:
+                m_asm.ucomisd( Xmm::XMM0, Xmm::XMM1 );
+                return Condition::ABOVE_EQUAL;
+            case TokenType::LESS:
+                m_asm.ucomisd( Xmm::XMM1, Xmm::XMM0 );
+                return Condition::ABOVE;
+            default:
+                m_asm.ucomisd( Xmm::XMM1, Xmm::XMM0 );
+                return Condition::ABOVE_EQUAL;
+            }
+        }
+
+        bool isOrdering( TokenType::Type op ) const
+        {
+            return op == TokenType::GREATER || op == TokenType::GREATER_EQUAL ||
+                   op == TokenType::LESS || op == TokenType::LESS_EQUAL;
+        }
+
+        // Jumps to 'falseTarget' unless the condition is truthy. Comparisons
+        // branch on the flags directly.
+        void condition( Expr* expr, Label& falseTarget )
+        {
+            Binary* binary = dynamic_cast<Binary*>( expr );
+            if ( binary && isOrdering( binary->op.getType() ) )
+            {
+                auto [left, right] = operands( binary->left, binary->right );
+                if ( left != Type::NUMBER || right != Type::NUMBER )
+                    return mismatch( "applies an operator to a boolean" );
+
+                Condition holds = compare( binary->op.getType() );
+                m_asm.jump( holds == Condition::ABOVE ? Condition::BELOW_EQUAL
+                                                      : Condition::BELOW,
+                            falseTarget );
+                return;
+            }
+
+            expr->accept( this );
+            if ( m_type == Type::NUMBER )
+                return;
+
+            m_asm.movq( Register::RAX, Xmm::XMM0 );
+            m_asm.test( Register::RAX, Register::RAX );
+            m_asm.jump( Condition::EQUAL, falseTarget );
+        }
+
+        // Turns the flag byte in al into 0.0 or 1.0 in xmm0.
+        void boolean()
+        {
+            m_asm.movzxByte( Register::RAX, Register::RAX );
+            m_asm.cvtsi2sd( Xmm::XMM0, Register::RAX );
+            m_type = Type::BOOL;
+        }
+
+        void constant( Xmm dst, double value )
+        {
+            m_asm.mov( Register::RAX, bitsOf( value ) );
+            m_asm.movq( dst, Register::RAX );
+        }
+
+        Function* m_function;
+        Environment& m_globals;
+        Assembler m_asm{};
+        std::vector<Object> m_callees{};
+        const char* m_problem{ nullptr };
+
+        Label m_entry{};
+        Label m_body{};
+        Label m_return{};
+        Label m_bailout{};
+        Label m_exit{};
+
+        // The type of each live local, and where each open scope starts.
+        std::vector<Type> m_locals{};
+        std::vector<std::size_t> m_scopes{};
+        std::size_t m_slots{ 0 };
+        std::size_t m_maxSlots{ 0 };
+
+        Type m_type{ Type::NUMBER };
+        Type m_returnType;
+        Type m_selfType{ m_returnType };
+        bool m_returns{ false };
+        bool m_selfCalled{ false };
+        bool m_wrongReturnType{ false };
+    };
+
+    // Copies the code into memory of its own that is executable but no
+    // longer writable.
+    std::unique_ptr<Jit::Code> install( const std::vector<std::uint8_t>& code )
+    {
+#ifdef CPPLOX_JIT
+        std::size_t page = static_cast<std::size_t>( sysconf( _SC_PAGESIZE ) );
+        std::size_t size = ( code.size() + page - 1 ) / page * page;
+        void* memory = mmap( nullptr, size, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+        if ( memory == MAP_FAILED )
+            return nullptr;
+
+        std::memcpy( memory, code.data(), code.size() );
+        if ( mprotect( memory, size, PROT_READ | PROT_EXEC ) != 0 )
+        {
+            munmap( memory, size );
+            return nullptr;
+        }
+
+        return std::make_unique<Jit::Code>( memory, size );
+#else
+        static_cast<void>( code );
+        return nullptr;
+#endif
+    }
+
+    Jit::Code* compile( Function* function, Environment& globals )
+    {
+        auto start = std::chrono::steady_clock::now();
+        compiling.push_back( function );
+
+        auto compiler = std::make_unique<FunctionCompiler>(
+            function, globals, FunctionCompiler::Type::NUMBER );
+        bool compiled = compiler->compile();
+        if ( !compiled && compiler->assumedWrongReturnType() )
+        {
+            // Keep the first problem if the guess was not what was wrong.
+            auto retry = std::make_unique<FunctionCompiler>(
+                function, globals, FunctionCompiler::Type::BOOL );
+            compiled = retry->compile();
+            if ( compiled )
+                compiler = std::move( retry );
+        }
+
+        compiling.pop_back();
+
+        std::unique_ptr<Jit::Code> code = nullptr;
+        if ( compiled )
+            code = install( compiler->getAssembler().getCode() );
+
+        Jit::stats.seconds += std::chrono::duration<double>(
+                                  std::chrono::steady_clock::now() - start )
+                                  .count();
+
+        if ( !code )
+        {
+            function->jitFailed = true;
+            Jit::stats.rejected.push_back(
+                "fun " + function->name.getLexeme() + " (line " +
+                std::to_string( function->name.getLine() ) + ") " +
+                ( compiled ? "could not be installed"
+                           : compiler->getProblem() ) );
+            return nullptr;
+        }
+
+        code->returnsBool =
+            compiler->getReturnType() == FunctionCompiler::Type::BOOL;
+        code->callees = std::move( compiler->getCallees() );
+
+        ++Jit::stats.compiled;
+        Jit::stats.codeBytes += compiler->getAssembler().size();
+
+        function->jitCode = code.get();
+        return codes.emplace_back( std::move( code ) ).get();
+    }
+} // namespace
+
+Jit::Code::Code( void* memory, std::size_t size )
+    : memory{ memory }, size{ size },
+      entry{ reinterpret_cast<Entry>( memory ) }
+{
+}
+
+Jit::Code::~Code()
+{
+#ifdef CPPLOX_JIT
+    munmap( memory, size );
+#endif
+}
+
+bool Jit::isSupported()
+{
+#ifdef CPPLOX_JIT
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool Jit::run( Function* function, Span<const Object> arguments,
+               Environment& globals, Object& result )
+{
+    Code* code = function->jitCode;
+    if ( !code )
+    {
+        if ( function->jitFailed || ++function->calls < config.threshold )
+            return false;
+
+        code = compile( function, globals );
+        if ( !code )
+            return false;
+    }
+
+    // The Parser allows at most 255 arguments.
+    double values[255];
+    if ( arguments.size() > 255 )
+        return false;
+    for ( std::size_t i = 0; i < arguments.size(); ++i )
+    {
+        if ( !arguments[i].isNumber() )
+            return false;
+        values[i] = arguments[i].asNumber();
+    }
+
+    ++stats.calls;
+    stackLimit = addressOf( values ) - config.maxStack;
+
+    double value = 0.0;
+    if ( code->entry( values, &value ) )
+    {
+        if ( code->returnsBool )
+            result = Object{ value != 0.0 };
+        else
+            result = Object{ value };
+        return true;
+    }
+
+    ++stats.bailouts;
+    if ( ++code->bailouts >= config.maxBailouts )
+    {
+        // Other compiled code may still call it, which is harmless.
+        function->jitCode = nullptr;
+        function->jitFailed = true;
+        ++stats.abandoned;
+    }
+    return false;
+}
+
+void Jit::release()
+{
+    codes.clear();
+}
+
+void Jit::printStats( std::ostream& out )
+{
+    out << "[jit] compiled: " << stats.compiled << " functions, "
+        << stats.codeBytes << " bytes, time: " << stats.seconds * 1000.0
+        << " ms\n";
+    out << "[jit] calls: " << stats.calls << ", bailouts: " << stats.bailouts
+        << ", abandoned: " << stats.abandoned << '\n';
+    for ( const std::string& rejected : stats.rejected )
+        out << "[jit] not compiled: " << rejected << '\n';
+}
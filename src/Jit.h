@@ -0,0 +1,93 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Object.h"
+#include "Span.h"
+
+class Environment;
+struct Function;
+
+// A baseline compiler from the AST of hot tree-walker functions to x86-64
+// machine code.
+//
+// Only functions that work on numbers and booleans are compiled: their
+// parameters, locals, arithmetic, comparisons, branches, loops, and calls to
+// other such functions through globals. Anything else (strings, objects,
+// printing, closures) leaves the function to the interpreter. Compiled code
+// therefore has no side effects, so whenever it cannot go on, because a
+// value is not a number or a called global has been reassigned, it bails
+// out and the interpreter runs the whole call again from the start.
+namespace Jit
+{
+    struct Config
+    {
+        bool enabled{ false };
+
+        // Calls after which a function is compiled.
+        std::uint32_t threshold{ 100 };
+
+        // Bailouts after which compiled code is abandoned for good.
+        std::uint32_t maxBailouts{ 16 };
+
+        // Bytes of native stack compiled code may use before it bails out,
+        // so deep recursion is left to the interpreter.
+        std::size_t maxStack{ 1 << 20 };
+    };
+
+    struct Stats
+    {
+        std::size_t compiled{ 0 };
+        std::size_t codeBytes{ 0 };
+        std::size_t calls{ 0 };
+        std::size_t bailouts{ 0 };
+        std::size_t abandoned{ 0 };
+        double seconds{ 0.0 };
+
+        // Why each function that got hot was not compiled.
+        std::vector<std::string> rejected{};
+    };
+
+    // Returns 1 with the result stored if the call completed, or 0 if it
+    // bailed out.
+    using Entry = int ( * )( const double* arguments, double* result );
+
+    // The machine code of one function, in its own executable mapping.
+    struct Code
+    {
+        Code( void* memory, std::size_t size );
+        Code( const Code& ) = delete;
+        Code& operator=( const Code& ) = delete;
+        ~Code();
+
+        void* memory;
+        std::size_t size;
+        Entry entry;
+        bool returnsBool{ false };
+        std::uint32_t bailouts{ 0 };
+
+        // The functions the code calls. Holding them keeps their addresses
+        // from being reused, which the guards on calls compare against.
+        std::vector<Object> callees{};
+    };
+
+    inline Config config{};
+    inline Stats stats{};
+
+    // Whether this build can generate and run machine code at all.
+    bool isSupported();
+
+    // Counts a call of 'function' and, once it is hot, runs it as machine
+    // code. Returns false if the interpreter has to run the call instead.
+    bool run( Function* function, Span<const Object> arguments,
+              Environment& globals, Object& result );
+
+    // Frees all machine code. Run before the objects it refers to are
+    // collected for the last time.
+    void release();
+
+    void printStats( std::ostream& out );
+} // namespace Jit
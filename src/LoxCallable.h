@@ -1,24 +1,25 @@
 #pragma once
-#include <memory>
 #include <string>
-#include <variant>
-#include <vector>
+
+#include "HeapObject.h"
+#include "Span.h"
 
 class Interpreter;
-class LoxInstance;
+class Object;
 
-class LoxCallable
+class LoxCallable : public HeapObject
 {
 public:
+    explicit LoxCallable( Kind kind ) : HeapObject{ kind }
+    {
+    }
+
     virtual int arity() const = 0;
-    virtual std::variant<std::monostate, std::string, double, bool,
-                         std::shared_ptr<LoxCallable>,
-                         std::shared_ptr<LoxInstance>>
-    call( Interpreter& interpreter,
-          const std::vector<std::variant<std::monostate, std::string, double,
-                                         bool, std::shared_ptr<LoxCallable>,
-                                         std::shared_ptr<LoxInstance>>>&
-              arguments ) = 0;
+
+    // The Interpreter evaluates arguments onto the top of its frame stack,
+    // above one free slot for a receiver, and Lox functions bind them as
+    // parameters right where they are. Natives only read them.
+    virtual Object call( Interpreter& interpreter,
+                         Span<const Object> arguments ) = 0;
     virtual std::string toString() const = 0;
-    virtual ~LoxCallable() = default;
-};
\ No newline at end of file
+};
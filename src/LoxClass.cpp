@@ -1,5 +1,6 @@
-#include <memory>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "Interpreter.h"
@@ -7,39 +8,63 @@
 #include "LoxFunction.h"
 #include "LoxInstance.h"
 #include "Object.h"
+#include "Symbol.h"
 
-std::shared_ptr<LoxFunction> LoxClass::findMethod(
-    const std::string& name ) const
+LoxClass::LoxClass( Kind kind, const std::string& name,
+                    Ref<LoxClass> superclass,
+                    std::unordered_map<Symbol, Ref<LoxFunction>> methods )
+    : LoxCallable{ kind }, m_name{ name }, superclass{ superclass },
+      m_methods{ std::move( methods ) }
 {
-    if ( m_methods.find( name ) != m_methods.end() )
-        return m_methods.at( name );
-
+    // Own methods are already in the table, so inherited ones only fill the
+    // gaps.
     if ( superclass )
-        return superclass->findMethod( name );
+        m_methods.insert( superclass->m_methods.begin(),
+                          superclass->m_methods.end() );
+
+    m_initializer = findMethod( Symbols::INIT );
+}
+
+LoxFunction* LoxClass::findMethod( Symbol name ) const
+{
+    auto method = m_methods.find( name );
+    if ( method != m_methods.end() )
+        return method->second.get();
 
     return nullptr;
 }
 
 int LoxClass::arity() const
 {
-    std::shared_ptr<LoxFunction> initializer = findMethod( "init" );
-    if ( !initializer.get() )
+    if ( !m_initializer )
         return 0;
-    return initializer->arity();
+    return m_initializer->arity();
 }
 
 Object LoxClass::call( Interpreter& interpreter,
-                       const std::vector<Object>& arguments )
+                       Span<const Object> arguments )
 {
-    std::shared_ptr<LoxInstance> instance =
-        std::make_shared<LoxInstance>( LoxInstance{ this } );
-    std::shared_ptr<LoxFunction> initializer = findMethod( "init" );
-    if ( initializer.get() )
-        initializer->bind( instance )->call( interpreter, arguments );
+    Ref<LoxInstance> instance = makeRef<LoxInstance>( Ref<LoxClass>{ this } );
+    if ( m_initializer )
+        m_initializer->invoke( interpreter, instance.get(), arguments );
     return instance;
 }
 
 std::string LoxClass::toString() const
 {
     return m_name;
+}
+
+void LoxClass::traverse( HeapVisitor& visitor ) const
+{
+    visitor.visit( superclass );
+    for ( const auto& [name, method] : m_methods )
+        visitor.visit( method );
+}
+
+void LoxClass::clear()
+{
+    superclass = nullptr;
+    m_methods.clear();
+    m_initializer = nullptr;
 }
\ No newline at end of file
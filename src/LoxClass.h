@@ -1,33 +1,57 @@
 #pragma once
 
-#include <map>
+#include <cstdint>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "HeapObject.h"
 #include "Interpreter.h"
 #include "LoxCallable.h"
 #include "Object.h"
+#include "Symbol.h"
 
 class LoxFunction;
 
+// Methods are flattened when the class is created: the table holds the
+// class's own methods plus every inherited one it does not override, so a
+// lookup costs the same however deep the hierarchy is.
 class LoxClass : public LoxCallable
 {
 public:
-    LoxClass(
-        const std::string& name, std::shared_ptr<LoxClass> superclass,
-        const std::map<std::string, std::shared_ptr<LoxFunction>>& methods )
-        : m_name{ name }, superclass{ superclass }, m_methods{ methods }
+    LoxClass( const std::string& name, Ref<LoxClass> superclass,
+              std::unordered_map<Symbol, Ref<LoxFunction>> methods )
+        : LoxClass{ Kind::CLASS, name, superclass, std::move( methods ) }
     {
     }
 
-    std::shared_ptr<LoxFunction> findMethod( const std::string& name ) const;
+    LoxFunction* findMethod( Symbol name ) const;
+
+    // Unique for the whole run, unlike the address of a class, which a
+    // later class can be allocated at.
+    std::uint64_t getId() const
+    {
+        return m_id;
+    }
+
     int arity() const override;
     Object call( Interpreter& interpreter,
-                 const std::vector<Object>& arguments ) override;
+                 Span<const Object> arguments ) override;
     std::string toString() const override;
+    void traverse( HeapVisitor& visitor ) const override;
+    void clear() override;
+
+protected:
+    LoxClass( Kind kind, const std::string& name, Ref<LoxClass> superclass,
+              std::unordered_map<Symbol, Ref<LoxFunction>> methods );
 
 private:
+    static inline std::uint64_t s_nextId{ 1 };
+
+    std::uint64_t m_id{ s_nextId++ };
     std::string m_name;
-    std::shared_ptr<LoxClass> superclass;
-    std::map<std::string, std::shared_ptr<LoxFunction>> m_methods;
+    Ref<LoxClass> superclass;
+    std::unordered_map<Symbol, Ref<LoxFunction>> m_methods;
+    LoxFunction* m_initializer{ nullptr };
 };
@@ -1,6 +1,5 @@
 #include <chrono>
 #include <string>
-#include <vector>
 
 #include "Interpreter.h"
 #include "LoxClock.h"
@@ -13,7 +12,7 @@ int LoxClock::arity() const
 
 [[maybe_unused]] Object LoxClock::call(
     [[maybe_unused]] Interpreter& interpreter,
-    [[maybe_unused]] const std::vector<Object>& arguments )
+    [[maybe_unused]] Span<const Object> arguments )
 {
     using namespace std::chrono;
     auto time =
@@ -1,6 +1,5 @@
 #pragma once
 #include <string>
-#include <vector>
 
 #include "LoxCallable.h"
 #include "Object.h"
@@ -8,11 +7,13 @@
 class LoxClock : public LoxCallable
 {
 public:
-    LoxClock() = default;
+    LoxClock() : LoxCallable{ Kind::NATIVE }
+    {
+    }
 
     int arity() const override;
     [[maybe_unused]] Object call(
         [[maybe_unused]] Interpreter& interpreter,
-        [[maybe_unused]] const std::vector<Object>& arguments ) override;
+        [[maybe_unused]] Span<const Object> arguments ) override;
     std::string toString() const override;
 };
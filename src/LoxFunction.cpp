@@ -1,22 +1,21 @@
-#include <memory>
+#include <cassert>
+#include <cstddef>
+#include <utility>
 #include <variant>
 #include <vector>
 
+#include "Completion.h"
 #include "Environment.h"
 #include "Interpreter.h"
+#include "Jit.h"
 #include "LoxFunction.h"
 #include "LoxInstance.h"
 #include "Object.h"
-#include "ReturnValue.h"
 
-std::shared_ptr<LoxFunction> LoxFunction::bind(
-    std::shared_ptr<LoxInstance> instance )
+Ref<LoxFunction> LoxFunction::bind( Ref<LoxInstance> instance )
 {
-    std::shared_ptr<Environment> environment =
-        std::make_shared<Environment>( Environment{ closure } );
-    environment->define( "this", instance );
-    return std::make_shared<LoxFunction>( declaration, environment,
-                                          m_isInitializer );
+    return makeRef<LoxFunction>( declaration, m_upvalues, m_isInitializer,
+                                 instance );
 }
 
 int LoxFunction::arity() const
@@ -25,34 +24,112 @@ int LoxFunction::arity() const
 }
 
 Object LoxFunction::call( Interpreter& interpreter,
-                          const std::vector<Object>& arguments )
+                          Span<const Object> arguments )
 {
-    std::shared_ptr<Environment> environment{ new Environment{ closure } };
-    for ( std::size_t i = 0; i < declaration->params.size(); ++i )
-    {
-        environment->define( declaration->params.at( i ).getLexeme(),
-                             arguments.at( i ) );
-    }
+    return invoke( interpreter, m_receiver.get(), arguments );
+}
 
-    try
-    {
-        interpreter.executeBlock( declaration->body, environment );
-    }
-    catch ( const ReturnValue& returnValue )
+Object LoxFunction::invoke( Interpreter& interpreter, LoxInstance* receiver,
+                            Span<const Object> arguments )
+{
+    // The arguments are already where the parameters go: the top of the
+    // frame stack, above a free slot that takes the receiver of a method.
+    std::vector<Object>& stack = interpreter.m_stack;
+    assert( arguments.end() == stack.data() + stack.size() );
+    std::size_t base =
+        static_cast<std::size_t>( arguments.begin() - stack.data() ) - 1;
+
+    // A tail call replaces the function, receiver and arguments and goes
+    // round again, so a chain of them runs in constant native stack. The
+    // pending call keeps the replacements alive.
+    LoxFunction* function = this;
+    Interpreter::PendingCall tailCall{};
+
+    while ( true )
     {
-        if ( m_isInitializer )
-            closure->getAt( 0, "this" );
+        if ( Jit::config.enabled && function->isStandalone() && !receiver )
+        {
+            Object result{};
+            if ( Jit::run( function->declaration,
+                           Span<const Object>{ stack.data() + base + 1,
+                                               stack.size() - base - 1 },
+                           *interpreter.m_globals, result ) )
+                return result;
+        }
 
-        return returnValue.value;
-    }
+        // Everything the body reads from enclosing scopes comes through
+        // its upvalues, so the frame only holds its own locals.
+        std::size_t frame = base + 1;
+        if ( receiver )
+        {
+            frame = base;
+            stack[base] = Ref<LoxInstance>{ receiver };
+        }
+
+        for ( int slot : function->declaration->capturedSlots )
+        {
+            Object& value = stack[frame + static_cast<std::size_t>( slot )];
+            value = makeRef<Cell>( value );
+        }
+
+        const std::vector<StmtCode>& compiled =
+            function->declaration->compiledBody;
+        Completion completion =
+            compiled.empty()
+                ? interpreter.executeBlock( function->declaration->body, frame,
+                                            &function->m_upvalues )
+                : interpreter.executeBlock( compiled, frame,
+                                            &function->m_upvalues );
 
-    if ( m_isInitializer )
-        return closure->getAt( 0, "this" );
+        if ( function->m_isInitializer )
+            return Ref<LoxInstance>{ receiver };
 
-    return Object{ std::monostate{} };
+        if ( !completion.isTailCall() )
+        {
+            if ( completion.isReturn() )
+                return std::move( completion.value );
+            return Object{ std::monostate{} };
+        }
+
+        // The frame is gone, so the tail call's arguments move down to
+        // where this call's were.
+        tailCall = std::move( interpreter.m_tailCall );
+        stack.resize( base );
+        stack.push_back( Object{ std::monostate{} } );
+        for ( Object& argument : interpreter.m_tailArguments )
+        {
+            stack.push_back( std::move( argument ) );
+        }
+        interpreter.m_tailArguments.clear();
+
+        // Classes and natives do not run Lox code in this frame.
+        if ( !tailCall.callee.isKind( Kind::FUNCTION ) )
+        {
+            return tailCall.callee.as<LoxCallable>()->call(
+                interpreter, Span<const Object>{ stack.data() + base + 1,
+                                                 stack.size() - base - 1 } );
+        }
+
+        function = tailCall.callee.as<LoxFunction>();
+        receiver = tailCall.receiver ? tailCall.receiver.get()
+                                     : function->m_receiver.get();
+    }
 }
 
 std::string LoxFunction::toString() const
 {
     return "<fn " + declaration->name.getLexeme() + ">";
 }
+
+void LoxFunction::traverse( HeapVisitor& visitor ) const
+{
+    for ( const Ref<Cell>& upvalue : m_upvalues )
+        visitor.visit( upvalue );
+    visitor.visit( m_receiver );
+}
+
+void LoxFunction::clear()
+{
+    m_upvalues.clear();
+    m_receiver = nullptr;
+}
@@ -1,35 +1,64 @@
 #pragma once
 #include <iostream>
-#include <memory>
+#include <utility>
 #include <vector>
 
 #include "Environment.h"
+#include "HeapObject.h"
 #include "LoxCallable.h"
 #include "Object.h"
 #include "Statement.h"
 
 class Interpreter;
+class LoxInstance;
 
 class LoxFunction : public LoxCallable
 {
 public:
-    LoxFunction( Function* declaration, std::shared_ptr<Environment> closure,
-                 bool isInitializer )
-        : declaration{ declaration }, closure{ closure },
+    LoxFunction( Function* declaration, std::vector<Ref<Cell>> upvalues,
+                 bool isInitializer, Ref<LoxInstance> receiver = nullptr )
+        : LoxCallable{ Kind::FUNCTION }, declaration{ declaration },
+          m_upvalues{ std::move( upvalues ) }, m_receiver{ receiver },
           m_isInitializer{ isInitializer }
     {
     }
 
-    std::shared_ptr<LoxFunction> bind( std::shared_ptr<LoxInstance> instance );
+    Ref<LoxFunction> bind( Ref<LoxInstance> instance );
     int arity() const override;
     Object call( Interpreter& interpreter,
-                 const std::vector<Object>& arguments ) override;
+                 Span<const Object> arguments ) override;
+
+    // Runs a method with 'receiver' as this, without binding it first.
+    // Methods keep this in slot 0 of their own frame, ahead of the
+    // parameters.
+    Object invoke( Interpreter& interpreter, LoxInstance* receiver,
+                   Span<const Object> arguments );
+
+    Function* getDeclaration() const
+    {
+        return declaration;
+    }
+
+    // Whether the function refers to nothing but its parameters, its own
+    // locals and globals.
+    bool isStandalone() const
+    {
+        return !m_receiver && m_upvalues.empty();
+    }
+
     std::string toString() const override;
+    void traverse( HeapVisitor& visitor ) const override;
+    void clear() override;
 
 private:
-    // Function is owned by a unique pointer, so this is fine. Maybe change
-    // AST to be made of shared_ptr?
+    // Owned by the Arena of the program the function was declared in,
+    // which outlives the interpreter's use of it.
     Function* declaration;
-    std::shared_ptr<Environment> closure;
+
+    // The cells of the variables the function captures, in the order of
+    // declaration->captures. The function keeps nothing else of the scope
+    // it was declared in.
+    std::vector<Ref<Cell>> m_upvalues;
+    Ref<LoxInstance> m_receiver;
     bool m_isInitializer;
 };
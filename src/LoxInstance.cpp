@@ -1,33 +1,111 @@
+#include <cstdint>
 #include <string>
 
 #include "Error.h"
 #include "LoxClass.h"
 #include "LoxFunction.h"
 #include "LoxInstance.h"
+#include "Shape.h"
 #include "Token.h"
 
-Object LoxInstance::get( const Token& name )
+Object LoxInstance::get( const Token& name, FieldCache& cache )
 {
-    if ( m_fields.find( name.getLexeme() ) != m_fields.end() )
-    {
-        return m_fields.at( name.getLexeme() );
-    }
+    if ( Object* field = findField( name.getSymbol(), cache ) )
+        return *field;
 
-    std::shared_ptr<LoxFunction> method =
-        m_klass->findMethod( name.getLexeme() );
-    if ( method.get() )
-        return method->bind( shared_from_this() );
+    if ( LoxFunction* method = m_klass->findMethod( name.getSymbol() ) )
+        return method->bind( Ref<LoxInstance>{ this } );
 
     throw Error::RuntimeError{ name, "Undefined property '" + name.getLexeme() +
                                          "'." };
 }
 
-void LoxInstance::set( const Token& name, const Object& value )
+void LoxInstance::set( const Token& name, const Object& value,
+                       FieldCache& cache )
+{
+    if ( const FieldCache::Entry* entry = cache.find( m_shape ) )
+    {
+        if ( entry->transition )
+        {
+            m_shape = entry->transition;
+            m_fields.push_back( value );
+        }
+        else
+        {
+            m_fields[entry->slot] = value;
+        }
+
+        return;
+    }
+
+    std::uint32_t slot = m_shape->lookup( name.getSymbol() );
+    if ( slot != Shape::NOT_FOUND )
+    {
+        cache.add( { m_shape, nullptr, slot } );
+        m_fields[slot] = value;
+        return;
+    }
+
+    Shape* next = m_shape->withField( name.getSymbol() );
+    cache.add( { m_shape, next, m_shape->getFieldCount() } );
+    m_shape = next;
+    m_fields.push_back( value );
+}
+
+Object* LoxInstance::findField( Symbol name )
+{
+    std::uint32_t slot = m_shape->lookup( name );
+    if ( slot == Shape::NOT_FOUND )
+        return nullptr;
+    return &m_fields[slot];
+}
+
+Object* LoxInstance::findField( Symbol name, FieldCache& cache )
+{
+    if ( const FieldCache::Entry* entry = cache.find( m_shape ) )
+        return &m_fields[entry->slot];
+
+    std::uint32_t slot = m_shape->lookup( name );
+    if ( slot == Shape::NOT_FOUND )
+        return nullptr;
+
+    cache.add( { m_shape, nullptr, slot } );
+    return &m_fields[slot];
+}
+
+void LoxInstance::setField( Symbol name, const Object& value )
+{
+    std::uint32_t slot = m_shape->lookup( name );
+    if ( slot != Shape::NOT_FOUND )
+    {
+        m_fields[slot] = value;
+        return;
+    }
+
+    m_shape = m_shape->withField( name );
+    m_fields.push_back( value );
+}
+
+LoxClass* LoxInstance::getClass() const
 {
-    m_fields.emplace( name.getLexeme(), value );
+    return m_klass.get();
 }
 
 std::string LoxInstance::toString() const
 {
     return m_klass->toString() + " instance";
+}
+
+void LoxInstance::traverse( HeapVisitor& visitor ) const
+{
+    visitor.visit( m_klass );
+    for ( const Object& value : m_fields )
+        visitor.visit( value );
+}
+
+void LoxInstance::clear()
+{
+    m_klass = nullptr;
+    m_shape = Shape::empty();
+    m_fields.clear();
 }
\ No newline at end of file
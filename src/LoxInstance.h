@@ -1,26 +1,38 @@
 #pragma once
 
-#include <map>
-#include <memory>
 #include <string>
+#include <vector>
 
+#include "HeapObject.h"
 #include "Object.h"
+#include "Shape.h"
+#include "Symbol.h"
 
 class LoxClass;
 class Token;
 
-class LoxInstance : public std::enable_shared_from_this<LoxInstance>
+// Fields are stored densely in declaration order; the shape maps names to
+// slots and is shared with every instance that has the same fields.
+class LoxInstance : public HeapObject
 {
 public:
-    LoxInstance( LoxClass* klass ) : m_klass{ klass }
+    LoxInstance( Ref<LoxClass> klass )
+        : HeapObject{ Kind::INSTANCE }, m_klass{ klass }
     {
     }
 
-    Object get( const Token& name );
-    void set( const Token& name, const Object& value );
+    Object get( const Token& name, FieldCache& cache );
+    void set( const Token& name, const Object& value, FieldCache& cache );
+    Object* findField( Symbol name );
+    Object* findField( Symbol name, FieldCache& cache );
+    void setField( Symbol name, const Object& value );
+    LoxClass* getClass() const;
     std::string toString() const;
+    void traverse( HeapVisitor& visitor ) const override;
+    void clear() override;
 
 private:
-    LoxClass* m_klass;
-    std::map<std::string, Object> m_fields;
+    Ref<LoxClass> m_klass;
+    Shape* m_shape{ Shape::empty() };
+    std::vector<Object> m_fields{};
 };
@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "HeapObject.h"
+#include "LoxString.h"
+
+namespace
+{
+    // Concatenations up to this length are copied into a flat string right
+    // away. Appending a short piece to a rope then only copies the rope's
+    // last leaf, which also keeps the number of nodes down.
+    constexpr std::size_t MAX_FLAT_CONCAT = 256;
+} // namespace
+
+LoxString::LoxString( std::string value )
+    : HeapObject{ Kind::STRING }, m_value{ std::move( value ) },
+      m_length{ m_value.size() }
+{
+}
+
+LoxString::LoxString( const Ref<LoxString>& left, const Ref<LoxString>& right )
+    : HeapObject{ Kind::STRING }, m_left{ left }, m_right{ right },
+      m_height{ static_cast<std::uint8_t>(
+          std::max( left->m_height, right->m_height ) + 1 ) },
+      m_length{ left->m_length + right->m_length }
+{
+}
+
+Ref<LoxString> LoxString::concat( const Ref<LoxString>& left,
+                                  const Ref<LoxString>& right )
+{
+    if ( left->m_length == 0 )
+        return right;
+    if ( right->m_length == 0 )
+        return left;
+
+    return join( left, right );
+}
+
+const std::string& LoxString::getValue() const
+{
+    if ( !isFlat() )
+        flatten();
+    return m_value;
+}
+
+std::size_t LoxString::getLength() const
+{
+    return m_length;
+}
+
+std::size_t LoxString::getHash() const
+{
+    if ( !m_hashed )
+    {
+        m_hash = std::hash<std::string>{}( getValue() );
+        m_hashed = true;
+    }
+    return m_hash;
+}
+
+bool LoxString::equals( const LoxString& other ) const
+{
+    if ( this == &other )
+        return true;
+    if ( m_length != other.m_length )
+        return false;
+    // Only compare hashes that are already known; computing one costs as
+    // much as comparing the characters.
+    if ( m_hashed && other.m_hashed && m_hash != other.m_hash )
+        return false;
+    return getValue() == other.getValue();
+}
+
+bool LoxString::isFlat() const
+{
+    return m_height == 0;
+}
+
+void LoxString::flatten() const
+{
+    // Walk the leaves left to right with an explicit stack. Halves that were
+    // flattened earlier are copied as a whole.
+    std::string value{};
+    value.reserve( m_length );
+
+    std::vector<const LoxString*> pending{ this };
+    while ( !pending.empty() )
+    {
+        const LoxString* string = pending.back();
+        pending.pop_back();
+
+        if ( string->isFlat() )
+        {
+            value += string->m_value;
+            continue;
+        }
+
+        pending.push_back( string->m_right.get() );
+        pending.push_back( string->m_left.get() );
+    }
+
+    m_value = std::move( value );
+    m_left = nullptr;
+    m_right = nullptr;
+    m_height = 0;
+}
+
+Ref<LoxString> LoxString::join( const Ref<LoxString>& left,
+                                const Ref<LoxString>& right )
+{
+    // AVL-style join of two balanced ropes: descend the taller side's inner
+    // spine until the heights are within one, then rotate on the way back
+    // up. Nodes are shared, never modified, so each step allocates new ones.
+    if ( left->m_length + right->m_length <= MAX_FLAT_CONCAT )
+        return makeRef<LoxString>( left->getValue() + right->getValue() );
+
+    int leftHeight = left->m_height;
+    int rightHeight = right->m_height;
+
+    if ( leftHeight > rightHeight + 1 )
+    {
+        Ref<LoxString> inner = join( left->m_right, right );
+        if ( inner->m_height <= left->m_left->m_height + 1 )
+            return node( left->m_left, inner );
+
+        if ( inner->m_left->m_height <= inner->m_right->m_height )
+            return node( node( left->m_left, inner->m_left ), inner->m_right );
+
+        return node( node( left->m_left, inner->m_left->m_left ),
+                     node( inner->m_left->m_right, inner->m_right ) );
+    }
+
+    if ( rightHeight > leftHeight + 1 )
+    {
+        Ref<LoxString> inner = join( left, right->m_left );
+        if ( inner->m_height <= right->m_right->m_height + 1 )
+            return node( inner, right->m_right );
+
+        if ( inner->m_right->m_height <= inner->m_left->m_height )
+            return node( inner->m_left, node( inner->m_right, right->m_right ) );
+
+        return node( node( inner->m_left, inner->m_right->m_left ),
+                     node( inner->m_right->m_right, right->m_right ) );
+    }
+
+    return node( left, right );
+}
+
+Ref<LoxString> LoxString::node( const Ref<LoxString>& left,
+                                const Ref<LoxString>& right )
+{
+    return Ref<LoxString>{ new LoxString{ left, right } };
+}
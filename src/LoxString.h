@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "HeapObject.h"
+
+// An immutable Lox string. Values share one LoxString by reference, so
+// copying a string value is a pointer copy. The hash is computed the first
+// time it is needed and cached.
+//
+// Concatenation builds a rope: a node that only records its two halves.
+// The characters are joined the first time they are needed, after which
+// the node is a plain flat string. Short results are copied eagerly, and
+// rope nodes are kept height-balanced so a long run of appends stays
+// logarithmic in depth.
+class LoxString : public HeapObject
+{
+public:
+    explicit LoxString( std::string value );
+
+    static Ref<LoxString> concat( const Ref<LoxString>& left,
+                                  const Ref<LoxString>& right );
+
+    const std::string& getValue() const;
+    std::size_t getLength() const;
+    std::size_t getHash() const;
+    bool equals( const LoxString& other ) const;
+
+private:
+    LoxString( const Ref<LoxString>& left, const Ref<LoxString>& right );
+
+    bool isFlat() const;
+    void flatten() const;
+
+    static Ref<LoxString> join( const Ref<LoxString>& left,
+                                const Ref<LoxString>& right );
+    static Ref<LoxString> node( const Ref<LoxString>& left,
+                                const Ref<LoxString>& right );
+
+    // Flattening replaces the halves with the joined characters, so these
+    // change on first read even though the string itself never does.
+    mutable std::string m_value{};
+    mutable Ref<LoxString> m_left{};
+    mutable Ref<LoxString> m_right{};
+    mutable std::uint8_t m_height{ 0 };
+    const std::size_t m_length;
+    mutable std::size_t m_hash{ 0 };
+    mutable bool m_hashed{ false };
+};
@@ -1,14 +1,338 @@
 #pragma once
+#include <cstdint>
+#include <cstring>
+#include <ostream>
 #include <string>
+#include <utility>
 #include <variant>
 
-#include "LoxCallable.h"
+#include "HeapObject.h"
+#include "LoxString.h"
 
-class LoxCallable;
-class LoxInstance;
+// A Lox value: nil, a boolean, a number, or a reference to a heap object
+// (string, callable or instance). Strings are immutable and shared, so
+// copying a value never copies characters.
+//
+// With CPPLOX_NAN_BOXING (the default) a value is a single 64-bit word.
+// Numbers are stored as plain doubles, and nil, booleans and object pointers
+// are encoded in the unused payload bits of a quiet NaN. Building without it
+// keeps a std::variant representation, which is twice as large but easier
+// to inspect in a debugger.
+class Object
+{
+public:
+    Object();
+    Object( std::monostate );
+    Object( bool value );
+    Object( double value );
+    Object( std::string value );
+    Object( const char* value );
 
-using Object =
-    std::variant<std::monostate, std::string, double, bool,
-                 std::shared_ptr<LoxCallable>, std::shared_ptr<LoxInstance>>;
+    template <typename T>
+    Object( const Ref<T>& object );
+
+#ifdef CPPLOX_NAN_BOXING
+    Object( const Object& other );
+    Object( Object&& other ) noexcept;
+    Object& operator=( const Object& other );
+    Object& operator=( Object&& other ) noexcept;
+    ~Object();
+#endif
+
+    bool isNil() const;
+    bool isBool() const;
+    bool isNumber() const;
+    bool isString() const;
+    bool isObject() const;
+    bool isCallable() const;
+    bool isInstance() const;
+    bool isKind( HeapObject::Kind kind ) const;
+
+    bool asBool() const;
+    double asNumber() const;
+    const std::string& asString() const;
+    HeapObject* asObject() const;
+
+    template <typename T>
+    T* as() const
+    {
+        return static_cast<T*>( asObject() );
+    }
+
+    template <typename T>
+    Ref<T> asRef() const
+    {
+        return Ref<T>{ as<T>() };
+    }
+
+    friend bool operator==( const Object& a, const Object& b );
+    friend bool operator!=( const Object& a, const Object& b );
+
+private:
+#ifdef CPPLOX_NAN_BOXING
+    static constexpr std::uint64_t SIGN_BIT = 0x8000000000000000;
+    static constexpr std::uint64_t QNAN = 0x7ffc000000000000;
+    static constexpr std::uint64_t CANONICAL_NAN = 0x7ff8000000000000;
+    static constexpr std::uint64_t NIL_VALUE = QNAN | 1;
+    static constexpr std::uint64_t FALSE_VALUE = QNAN | 2;
+    static constexpr std::uint64_t TRUE_VALUE = QNAN | 3;
+
+    void setObject( HeapObject* object );
+
+    std::uint64_t m_bits;
+#else
+    using Value = std::variant<std::monostate, double, bool, Ref<HeapObject>>;
+
+    Value m_value;
+#endif
+};
 
 std::string objectToString( const Object& obj );
+void printObject( std::ostream& out, const Object& obj );
+
+#ifdef CPPLOX_NAN_BOXING
+
+inline Object::Object() : m_bits{ NIL_VALUE }
+{
+}
+
+inline Object::Object( std::monostate ) : m_bits{ NIL_VALUE }
+{
+}
+
+inline Object::Object( bool value )
+    : m_bits{ value ? TRUE_VALUE : FALSE_VALUE }
+{
+}
+
+inline Object::Object( double value )
+{
+    std::memcpy( &m_bits, &value, sizeof( double ) );
+
+    // Hardware NaNs never carry a payload, but fold them to one canonical
+    // pattern so no arithmetic result can be mistaken for a tagged value.
+    // The sign is kept: it is printed, as "-nan" for 0/0.
+    if ( value != value )
+        m_bits = ( m_bits & SIGN_BIT ) | CANONICAL_NAN;
+}
+
+template <typename T>
+Object::Object( const Ref<T>& object )
+{
+    if ( object )
+        setObject( object.getObject() );
+    else
+        m_bits = NIL_VALUE;
+}
+
+inline Object::Object( const Object& other ) : m_bits{ other.m_bits }
+{
+    if ( isObject() )
+        asObject()->retain();
+}
+
+inline Object::Object( Object&& other ) noexcept : m_bits{ other.m_bits }
+{
+    other.m_bits = NIL_VALUE;
+}
+
+inline Object& Object::operator=( const Object& other )
+{
+    // Retain first so self-assignment cannot free the object.
+    if ( other.isObject() )
+        other.asObject()->retain();
+    if ( isObject() )
+        asObject()->release();
+
+    m_bits = other.m_bits;
+    return *this;
+}
+
+inline Object& Object::operator=( Object&& other ) noexcept
+{
+    std::swap( m_bits, other.m_bits );
+    return *this;
+}
+
+inline Object::~Object()
+{
+    if ( isObject() )
+        asObject()->release();
+}
+
+inline void Object::setObject( HeapObject* object )
+{
+    object->retain();
+    m_bits = SIGN_BIT | QNAN |
+             static_cast<std::uint64_t>( reinterpret_cast<std::uintptr_t>(
+                 object ) );
+}
+
+inline bool Object::isNil() const
+{
+    return m_bits == NIL_VALUE;
+}
+
+inline bool Object::isBool() const
+{
+    return ( m_bits | 1 ) == TRUE_VALUE;
+}
+
+inline bool Object::isNumber() const
+{
+    return ( m_bits & QNAN ) != QNAN;
+}
+
+inline bool Object::isObject() const
+{
+    return ( m_bits & ( QNAN | SIGN_BIT ) ) == ( QNAN | SIGN_BIT );
+}
+
+inline bool Object::asBool() const
+{
+    return m_bits == TRUE_VALUE;
+}
+
+inline double Object::asNumber() const
+{
+    double value;
+    std::memcpy( &value, &m_bits, sizeof( double ) );
+    return value;
+}
+
+inline HeapObject* Object::asObject() const
+{
+    return reinterpret_cast<HeapObject*>(
+        static_cast<std::uintptr_t>( m_bits & ~( SIGN_BIT | QNAN ) ) );
+}
+
+inline bool operator==( const Object& a, const Object& b )
+{
+    if ( a.isNumber() && b.isNumber() )
+        return a.asNumber() == b.asNumber();
+
+    if ( a.m_bits == b.m_bits )
+        return true;
+
+    return a.isString() && b.isString() &&
+           a.as<LoxString>()->equals( *b.as<LoxString>() );
+}
+
+#else
+
+inline Object::Object() : m_value{ std::monostate{} }
+{
+}
+
+inline Object::Object( std::monostate ) : m_value{ std::monostate{} }
+{
+}
+
+inline Object::Object( bool value ) : m_value{ value }
+{
+}
+
+inline Object::Object( double value ) : m_value{ value }
+{
+}
+
+
+// Built in the initializer rather than assigned to, which GCC cannot see
+// through and warns that the variant may be uninitialized.
+template <typename T>
+Object::Object( const Ref<T>& object )
+    : m_value{ object ? Value{ std::in_place_type<Ref<HeapObject>>,
+                               object.getObject() }
+                      : Value{} }
+{
+}
+
+inline bool Object::isNil() const
+{
+    return std::holds_alternative<std::monostate>( m_value );
+}
+
+inline bool Object::isBool() const
+{
+    return std::holds_alternative<bool>( m_value );
+}
+
+inline bool Object::isNumber() const
+{
+    return std::holds_alternative<double>( m_value );
+}
+
+inline bool Object::isObject() const
+{
+    return std::holds_alternative<Ref<HeapObject>>( m_value );
+}
+
+inline bool Object::asBool() const
+{
+    return std::get<bool>( m_value );
+}
+
+inline double Object::asNumber() const
+{
+    return std::get<double>( m_value );
+}
+
+inline HeapObject* Object::asObject() const
+{
+    return std::get<Ref<HeapObject>>( m_value ).get();
+}
+
+inline bool operator==( const Object& a, const Object& b )
+{
+    if ( a.isString() && b.isString() )
+        return a.as<LoxString>()->equals( *b.as<LoxString>() );
+
+    return a.m_value == b.m_value;
+}
+
+#endif
+
+inline Object::Object( std::string value )
+    : Object{ makeRef<LoxString>( std::move( value ) ) }
+{
+}
+
+inline Object::Object( const char* value ) : Object{ std::string{ value } }
+{
+}
+
+inline bool Object::isString() const
+{
+    return isKind( HeapObject::Kind::STRING );
+}
+
+inline const std::string& Object::asString() const
+{
+    return as<LoxString>()->getValue();
+}
+
+inline bool Object::isCallable() const
+{
+    return isObject() && asObject()->isCallable();
+}
+
+inline bool Object::isInstance() const
+{
+    return isKind( HeapObject::Kind::INSTANCE );
+}
+
+inline bool Object::isKind( HeapObject::Kind kind ) const
+{
+    return isObject() && asObject()->getKind() == kind;
+}
+
+inline bool operator!=( const Object& a, const Object& b )
+{
+    return !( a == b );
+}
+
+inline void HeapVisitor::visit( const Object& value )
+{
+    if ( value.isObject() )
+        visit( value.asObject() );
+}
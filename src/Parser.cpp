@@ -1,10 +1,10 @@
 #include <initializer_list>
-#include <memory>
 #include <stdexcept>
 #include <utility>
 #include <variant>
 #include <vector>
 
+#include "Arena.h"
 #include "Error.h"
 #include "Expression.h"
 #include "Object.h"
@@ -16,12 +16,12 @@ ParseError::ParseError( const std::string& error ) : std::runtime_error{ error }
 {
 }
 
-std::unique_ptr<Expr> Parser::expression()
+Expr* Parser::expression()
 {
     return assignment();
 }
 
-std::unique_ptr<Stmt> Parser::declaration()
+Stmt* Parser::declaration()
 {
     try
     {
@@ -47,31 +47,30 @@ std::unique_ptr<Stmt> Parser::declaration()
     }
 }
 
-std::unique_ptr<Stmt> Parser::classDeclaration()
+Stmt* Parser::classDeclaration()
 {
     Token name = consume( TokenType::IDENTIFIER, "Expect class name." );
 
-    std::unique_ptr<Variable> superclass = nullptr;
+    Variable* superclass = nullptr;
     if ( match( { TokenType::LESS } ) )
     {
         consume( TokenType::IDENTIFIER, "Expect superclass name." );
-        superclass = std::make_unique<Variable>( previous() );
+        superclass = m_arena.make<Variable>( previous() );
     }
 
     consume( TokenType::LEFT_BRACE, "Expect '{' before class body." );
-    std::vector<std::unique_ptr<Function>> methods{};
+    std::vector<Function*> methods{};
     while ( !check( TokenType::RIGHT_BRACE ) && !isAtEnd() )
     {
-        methods.push_back( std::move( function( "method" ) ) );
+        methods.push_back( function( "method" ) );
     }
 
     consume( TokenType::RIGHT_BRACE, "Expect '}' after class body." );
 
-    return std::make_unique<ClassStmt>( name, std::move( superclass ),
-                                        std::move( methods ) );
+    return m_arena.make<ClassStmt>( name, superclass, m_arena.list( methods ) );
 }
 
-std::unique_ptr<Stmt> Parser::statement()
+Stmt* Parser::statement()
 {
     if ( match( { TokenType::FOR } ) )
     {
@@ -100,17 +99,17 @@ std::unique_ptr<Stmt> Parser::statement()
 
     if ( match( { TokenType::LEFT_BRACE } ) )
     {
-        return std::make_unique<Block>( block() );
+        return m_arena.make<Block>( block() );
     }
 
     return expressionStatement();
 }
 
-std::unique_ptr<Stmt> Parser::forStatement()
+Stmt* Parser::forStatement()
 {
     consume( TokenType::LEFT_PAREN, "Expect '(' after 'for'." );
 
-    std::unique_ptr<Stmt> initializer;
+    Stmt* initializer;
     if ( match( { TokenType::SEMICOLON } ) )
     {
         initializer = nullptr;
@@ -124,7 +123,7 @@ std::unique_ptr<Stmt> Parser::forStatement()
         initializer = expressionStatement();
     }
 
-    std::unique_ptr<Expr> condition = nullptr;
+    Expr* condition = nullptr;
     if ( !check( TokenType::SEMICOLON ) )
     {
         condition = expression();
@@ -132,111 +131,105 @@ std::unique_ptr<Stmt> Parser::forStatement()
 
     consume( TokenType::SEMICOLON, "Expect ';' after loop condition." );
 
-    std::unique_ptr<Expr> increment = nullptr;
+    Expr* increment = nullptr;
     if ( !check( TokenType::RIGHT_PAREN ) )
     {
         increment = expression();
     }
     consume( TokenType::RIGHT_PAREN, "Expect ')' after for clauses." );
 
-    std::unique_ptr<Stmt> body = statement();
+    Stmt* body = statement();
 
     if ( increment )
     {
-        std::vector<std::unique_ptr<Stmt>> temp;
-        temp.push_back( std::move( body ) );
-        temp.push_back(
-            std::make_unique<Expression>( std::move( increment ) ) );
-        body = std::make_unique<Block>( std::move( temp ) );
+        std::vector<Stmt*> temp{ body,
+                                 m_arena.make<Expression>( increment ) };
+        body = m_arena.make<Block>( m_arena.list( temp ) );
     }
 
     if ( !condition )
     {
-        condition = std::make_unique<Literal>( true );
+        condition = m_arena.make<Literal>( true );
     }
-    body = std::make_unique<While>( std::move( condition ), std::move( body ) );
+    body = m_arena.make<While>( condition, body );
 
     if ( initializer )
     {
-        std::vector<std::unique_ptr<Stmt>> temp;
-        temp.push_back( std::move( initializer ) );
-        temp.push_back( std::move( body ) );
-        body = std::make_unique<Block>( std::move( temp ) );
+        std::vector<Stmt*> temp{ initializer, body };
+        body = m_arena.make<Block>( m_arena.list( temp ) );
     }
 
     return body;
 }
 
-std::unique_ptr<Stmt> Parser::ifStatement()
+Stmt* Parser::ifStatement()
 {
     consume( TokenType::LEFT_PAREN, "Expect '(' after 'if'." );
-    std::unique_ptr<Expr> condition = expression();
+    Expr* condition = expression();
     consume( TokenType::RIGHT_PAREN, "Expect ')' after if condition." );
 
-    std::unique_ptr<Stmt> thenBranch = statement();
-    std::unique_ptr<Stmt> elseBranch = nullptr;
+    Stmt* thenBranch = statement();
+    Stmt* elseBranch = nullptr;
     if ( match( { TokenType::ELSE } ) )
     {
         elseBranch = statement();
     }
 
-    return std::make_unique<If>( std::move( condition ),
-                                 std::move( thenBranch ),
-                                 std::move( elseBranch ) );
+    return m_arena.make<If>( condition, thenBranch, elseBranch );
 }
 
-std::unique_ptr<Stmt> Parser::printStatement()
+Stmt* Parser::printStatement()
 {
-    std::unique_ptr<Expr> value = expression();
+    Expr* value = expression();
     consume( TokenType::SEMICOLON, "Expect ';' after value." );
-    return std::make_unique<Print>( std::move( value ) );
+    return m_arena.make<Print>( value );
 }
 
-std::unique_ptr<Stmt> Parser::returnStatement()
+Stmt* Parser::returnStatement()
 {
     Token keyword = previous();
-    std::unique_ptr<Expr> value = nullptr;
+    Expr* value = nullptr;
     if ( !check( TokenType::SEMICOLON ) )
     {
         value = expression();
     }
 
     consume( TokenType::SEMICOLON, "Expect ';' after return value." );
-    return std::make_unique<Return>( keyword, std::move( value ) );
+    return m_arena.make<Return>( keyword, value );
 }
 
-std::unique_ptr<Stmt> Parser::whileStatement()
+Stmt* Parser::whileStatement()
 {
     consume( TokenType::LEFT_PAREN, "Expect '(' after 'while'." );
-    std::unique_ptr<Expr> condition = expression();
+    Expr* condition = expression();
     consume( TokenType::RIGHT_PAREN, "Expect ')' after condition." );
-    std::unique_ptr<Stmt> body = statement();
+    Stmt* body = statement();
 
-    return std::make_unique<While>( std::move( condition ), std::move( body ) );
+    return m_arena.make<While>( condition, body );
 }
 
-std::unique_ptr<Stmt> Parser::varDeclaration()
+Stmt* Parser::varDeclaration()
 {
     Token name = consume( TokenType::IDENTIFIER, "Expect variable name." );
 
-    std::unique_ptr<Expr> initializer = nullptr;
+    Expr* initializer = nullptr;
     if ( match( { TokenType::EQUAL } ) )
     {
         initializer = expression();
     }
 
     consume( TokenType::SEMICOLON, "Expect ';' after variable declaration." );
-    return std::make_unique<Var>( name, std::move( initializer ) );
+    return m_arena.make<Var>( name, initializer );
 }
 
-std::unique_ptr<Stmt> Parser::expressionStatement()
+Stmt* Parser::expressionStatement()
 {
-    std::unique_ptr<Expr> expr = expression();
+    Expr* expr = expression();
     consume( TokenType::SEMICOLON, "Expect ';' after expresison." );
-    return std::make_unique<Expression>( std::move( expr ) );
+    return m_arena.make<Expression>( expr );
 }
 
-std::unique_ptr<Function> Parser::function( const std::string& kind )
+Function* Parser::function( const std::string& kind )
 {
     Token name = consume( TokenType::IDENTIFIER, "Expect " + kind + " name." );
 
@@ -262,46 +255,41 @@ std::unique_ptr<Function> Parser::function( const std::string& kind )
 
     consume( TokenType::LEFT_BRACE, "Expect '{' before " + kind + " body." );
 
-    std::vector<std::unique_ptr<Stmt>> body{ std::move( block() ) };
+    NodeList<Stmt*> body = block();
+    m_declaresFunctions = true;
 
-    return std::make_unique<Function>( name, std::move( parameters ),
-                                       std::move( body ) );
+    return m_arena.make<Function>( name, m_arena.list( parameters ), body );
 }
 
-std::vector<std::unique_ptr<Stmt>> Parser::block()
+NodeList<Stmt*> Parser::block()
 {
-    std::vector<std::unique_ptr<Stmt>> statements{};
+    std::vector<Stmt*> statements{};
 
     while ( !check( TokenType::RIGHT_BRACE ) && !isAtEnd() )
     {
-        statements.push_back( std::move( declaration() ) );
+        statements.push_back( declaration() );
     }
 
     consume( TokenType::RIGHT_BRACE, "Expect '}' after block." );
-    return statements;
+    return m_arena.list( statements );
 }
 
-std::unique_ptr<Expr> Parser::assignment()
+Expr* Parser::assignment()
 {
-    std::unique_ptr<Expr> expr = orExpression();
+    Expr* expr = orExpression();
 
     if ( match( { TokenType::EQUAL } ) )
     {
         Token equals = previous();
-        std::unique_ptr<Expr> value = assignment();
+        Expr* value = assignment();
 
-        if ( dynamic_cast<Variable*>( expr.get() ) )
+        if ( auto variable = dynamic_cast<Variable*>( expr ) )
         {
-            Token name = dynamic_cast<Variable*>( expr.get() )->name;
-            return std::make_unique<Assign>( name, std::move( value ) );
+            return m_arena.make<Assign>( variable->name, value );
         }
-        else if ( dynamic_cast<Get*>( expr.get() ) )
+        else if ( auto get = dynamic_cast<Get*>( expr ) )
         {
-            Token name = dynamic_cast<Get*>( expr.get() )->name;
-            std::unique_ptr<Expr> object =
-                std::move( dynamic_cast<Get*>( expr.get() )->object );
-            return std::make_unique<Set>( std::move( object ), name,
-                                          std::move( value ) );
+            return m_arena.make<Set>( get->object, get->name, value );
         }
 
         Error::error( equals, "Invalid assignment target." );
@@ -310,124 +298,118 @@ std::unique_ptr<Expr> Parser::assignment()
     return expr;
 }
 
-std::unique_ptr<Expr> Parser::orExpression()
+Expr* Parser::orExpression()
 {
-    std::unique_ptr<Expr> expr = andExpression();
+    Expr* expr = andExpression();
 
     while ( match( { TokenType::OR } ) )
     {
         Token op = previous();
-        std::unique_ptr<Expr> right = andExpression();
-        expr = std::make_unique<Logical>( std::move( expr ), op,
-                                          std::move( right ) );
+        Expr* right = andExpression();
+        expr = m_arena.make<Logical>( expr, op, right );
     }
 
     return expr;
 }
 
-std::unique_ptr<Expr> Parser::andExpression()
+Expr* Parser::andExpression()
 {
-    std::unique_ptr<Expr> expr = equality();
+    Expr* expr = equality();
 
     while ( match( { TokenType::AND } ) )
     {
         Token op = previous();
-        std::unique_ptr<Expr> right = equality();
-        expr = std::make_unique<Logical>( std::move( expr ), op,
-                                          std::move( right ) );
+        Expr* right = equality();
+        expr = m_arena.make<Logical>( expr, op, right );
     }
 
     return expr;
 }
 
-std::unique_ptr<Expr> Parser::equality()
+Expr* Parser::equality()
 {
-    std::unique_ptr<Expr> expr = comparison();
+    Expr* expr = comparison();
 
     while ( match( { TokenType::BANG_EQUAL, TokenType::EQUAL_EQUAL } ) )
     {
         Token op = previous();
-        std::unique_ptr<Expr> right = comparison();
-        expr = std::make_unique<Binary>( std::move( expr ), op,
-                                         std::move( right ) );
+        Expr* right = comparison();
+        expr = m_arena.make<Binary>( expr, op, right );
     }
 
     return expr;
 }
 
-std::unique_ptr<Expr> Parser::comparison()
+Expr* Parser::comparison()
 {
-    std::unique_ptr<Expr> expr = term();
+    Expr* expr = term();
 
     while ( match( { TokenType::GREATER, TokenType::GREATER_EQUAL,
                      TokenType::LESS, TokenType::LESS_EQUAL } ) )
     {
         Token op = previous();
-        std::unique_ptr<Expr> right = term();
-        expr = std::make_unique<Binary>( std::move( expr ), op,
-                                         std::move( right ) );
+        Expr* right = term();
+        expr = m_arena.make<Binary>( expr, op, right );
     }
 
     return expr;
 }
 
-std::unique_ptr<Expr> Parser::term()
+Expr* Parser::term()
 {
-    std::unique_ptr<Expr> expr = factor();
+    Expr* expr = factor();
 
     while ( match( { TokenType::MINUS, TokenType::PLUS } ) )
     {
         Token op = previous();
-        std::unique_ptr<Expr> right = factor();
-        expr = std::make_unique<Binary>( std::move( expr ), op,
-                                         std::move( right ) );
+        Expr* right = factor();
+        expr = m_arena.make<Binary>( expr, op, right );
     }
 
     return expr;
 }
 
-std::unique_ptr<Expr> Parser::factor()
+Expr* Parser::factor()
 {
-    std::unique_ptr<Expr> expr = unary();
+    Expr* expr = unary();
 
     while ( match( { TokenType::SLASH, TokenType::STAR } ) )
     {
         Token op = previous();
-        std::unique_ptr<Expr> right = unary();
-        expr = std::make_unique<Binary>( std::move( expr ), op,
-                                         std::move( right ) );
+        Expr* right = unary();
+        expr = m_arena.make<Binary>( expr, op, right );
     }
 
     return expr;
 }
 
-std::unique_ptr<Expr> Parser::unary()
+Expr* Parser::unary()
 {
     if ( match( { TokenType::BANG, TokenType::MINUS } ) )
     {
         Token op = previous();
-        std::unique_ptr<Expr> right = unary();
-        return std::make_unique<Unary>( op, std::move( right ) );
+        Expr* right = unary();
+        return m_arena.make<Unary>( op, right );
     }
 
     return call();
 }
 
-std::unique_ptr<Expr> Parser::call()
+Expr* Parser::call()
 {
-    std::unique_ptr<Expr> expr = primary();
+    Expr* expr = primary();
 
     while ( true )
     {
         if ( match( { TokenType::LEFT_PAREN } ) )
         {
-            expr = finishCall( std::move( expr ) );
+            expr = finishCall( expr );
         }
         else if ( match( { TokenType::DOT } ) )
         {
             Token name = consume( TokenType::IDENTIFIER,
                                   "Expect property name after '.'" );
-            expr = std::make_unique<Get>( std::move( expr ), name );
+            expr = m_arena.make<Get>( expr, name );
         }
         else
         {
@@ -438,9 +420,9 @@ std::unique_ptr<Expr> Parser::call()
     return expr;
 }
 
-std::unique_ptr<Expr> Parser::finishCall( std::unique_ptr<Expr> callee )
+Expr* Parser::finishCall( Expr* callee )
 {
-    std::vector<std::unique_ptr<Expr>> arguments{};
+    std::vector<Expr*> arguments{};
 
     if ( !check( TokenType::RIGHT_PAREN ) )
     {
@@ -450,28 +432,29 @@ std::unique_ptr<Expr> Parser::finishCall( std::unique_ptr<Expr> callee )
             {
                 Error::error( peek(), "Can't have more than 255 arguments." );
             }
-            arguments.push_back( std::move( expression() ) );
+            arguments.push_back( expression() );
         } while ( match( { TokenType::COMMA } ) );
     }
 
     Token paren =
         consume( TokenType::RIGHT_PAREN, "Expect ')' after arguments." );
 
-    return std::make_unique<Call>( std::move( callee ), paren,
-                                   std::move( arguments ) );
+    Call* call = m_arena.make<Call>( callee, paren, m_arena.list( arguments ) );
+    call->property = dynamic_cast<Get*>( callee );
+    return call;
 }
 
-std::unique_ptr<Expr> Parser::primary()
+Expr* Parser::primary()
 {
     if ( match( { TokenType::FALSE } ) )
-        return std::make_unique<Literal>( Object{ false } );
+        return m_arena.make<Literal>( Object{ false } );
     if ( match( { TokenType::TRUE } ) )
-        return std::make_unique<Literal>( Object{ true } );
+        return m_arena.make<Literal>( Object{ true } );
     if ( match( { TokenType::NIL } ) )
-        return std::make_unique<Literal>( Object{ std::monostate{} } );
+        return m_arena.make<Literal>( Object{ std::monostate{} } );
 
     if ( match( { TokenType::NUMBER, TokenType::STRING } ) )
-        return std::make_unique<Literal>( Object{ previous().getLiteral() } );
+        return m_arena.make<Literal>( Object{ previous().getLiteral() } );
 
     if ( match( { TokenType::SUPER } ) )
     {
@@ -479,20 +462,20 @@ std::unique_ptr<Expr> Parser::primary()
         consume( TokenType::DOT, "Expect '.' after 'super'." );
         Token method =
             consume( TokenType::IDENTIFIER, "Expect superclass method name." );
-        return std::make_unique<Super>( keyword, method );
+        return m_arena.make<Super>( keyword, method );
     }
 
     if ( match( { TokenType::THIS } ) )
-        return std::make_unique<This>( previous() );
+        return m_arena.make<This>( previous() );
 
     if ( match( { TokenType::IDENTIFIER } ) )
-        return std::make_unique<Variable>( previous() );
+        return m_arena.make<Variable>( previous() );
 
     if ( match( { TokenType::LEFT_PAREN } ) )
     {
-        std::unique_ptr<Expr> expr = expression();
+        Expr* expr = expression();
         consume( TokenType::RIGHT_PAREN, "Expect ')' after expression." );
-        return std::make_unique<Grouping>( std::move( expr ) );
+        return m_arena.make<Grouping>( expr );
     }
 
     throw error( peek(), "Expect expression." );
@@ -585,17 +568,18 @@ void Parser::synchronize()
     }
 }
 
-Parser::Parser( const std::vector<Token>& tokens ) : m_tokens{ tokens }
+Parser::Parser( std::vector<Token> tokens, Arena& arena )
+    : m_tokens{ std::move( tokens ) }, m_arena{ arena }
 {
 }
 
-std::vector<std::unique_ptr<Stmt>> Parser::parse()
+NodeList<Stmt*> Parser::parse()
 {
-    std::vector<std::unique_ptr<Stmt>> statements{};
+    std::vector<Stmt*> statements{};
     while ( !isAtEnd() )
     {
-        statements.push_back( std::move( declaration() ) );
+        statements.push_back( declaration() );
     }
 
-    return statements;
+    return m_arena.list( statements );
 }
\ No newline at end of file
@@ -2,12 +2,12 @@
 #include <algorithm>
 #include <exception>
 #include <initializer_list>
-#include <memory>
 #include <stdexcept>
 #include <string>
 #include <variant>
 #include <vector>
 
+#include "Arena.h"
 #include "Error.h"
 #include "Expression.h"
 #include "Statement.h"
@@ -24,31 +24,33 @@ class Parser
 private:
     std::vector<Token> m_tokens;
     int m_current{ 0 };
+    Arena& m_arena;
+    bool m_declaresFunctions{ false };
 
-    std::unique_ptr<Expr> expression();
-    std::unique_ptr<Expr> assignment();
-    std::unique_ptr<Expr> orExpression();
-    std::unique_ptr<Expr> andExpression();
-    std::unique_ptr<Stmt> declaration();
-    std::unique_ptr<Stmt> classDeclaration();
-    std::unique_ptr<Stmt> whileStatement();
-    std::unique_ptr<Stmt> statement();
-    std::unique_ptr<Stmt> forStatement();
-    std::unique_ptr<Stmt> ifStatement();
-    std::unique_ptr<Stmt> printStatement();
-    std::unique_ptr<Stmt> returnStatement();
-    std::unique_ptr<Stmt> varDeclaration();
-    std::unique_ptr<Stmt> expressionStatement();
-    std::unique_ptr<Function> function( const std::string& kind );
-    std::vector<std::unique_ptr<Stmt>> block();
-    std::unique_ptr<Expr> equality();
-    std::unique_ptr<Expr> comparison();
-    std::unique_ptr<Expr> term();
-    std::unique_ptr<Expr> factor();
-    std::unique_ptr<Expr> unary();
-    std::unique_ptr<Expr> call();
-    std::unique_ptr<Expr> finishCall( std::unique_ptr<Expr> expr );
-    std::unique_ptr<Expr> primary();
+    Expr* expression();
+    Expr* assignment();
+    Expr* orExpression();
+    Expr* andExpression();
+    Stmt* declaration();
+    Stmt* classDeclaration();
+    Stmt* whileStatement();
+    Stmt* statement();
+    Stmt* forStatement();
+    Stmt* ifStatement();
+    Stmt* printStatement();
+    Stmt* returnStatement();
+    Stmt* varDeclaration();
+    Stmt* expressionStatement();
+    Function* function( const std::string& kind );
+    NodeList<Stmt*> block();
+    Expr* equality();
+    Expr* comparison();
+    Expr* term();
+    Expr* factor();
+    Expr* unary();
+    Expr* call();
+    Expr* finishCall( Expr* expr );
+    Expr* primary();
     bool match( std::initializer_list<TokenType::Type> types );
     Token& consume( TokenType::Type type, const std::string& message );
     bool check( TokenType::Type type );
@@ -60,7 +62,17 @@ private:
     void synchronize();
 
 public:
-    Parser( const std::vector<Token>& tokens );
+    // Nodes are allocated in 'arena', which must outlive every use of the
+    // returned program, including functions that refer to it at runtime.
+    Parser( std::vector<Token> tokens, Arena& arena );
 
-    std::vector<std::unique_ptr<Stmt>> parse();
+    NodeList<Stmt*> parse();
+
+    // Whether the program declares a function or method. Only those are
+    // referred to by runtime objects, so the arena of a program without any
+    // can be freed as soon as it has run.
+    bool declaresFunctions() const
+    {
+        return m_declaresFunctions;
+    }
 };
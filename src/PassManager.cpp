@@ -0,0 +1,274 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <unordered_set>
+
+#include "ConstantFolder.h"
+#include "DeadCodeEliminator.h"
+#include "Expression.h"
+#include "PassManager.h"
+#include "Statement.h"
+
+namespace
+{
+    // Counts the nodes of a program and notes the first way in which it is
+    // malformed: a missing child, a node reachable from two parents, or a
+    // call recorded on its parent that is no longer its child.
+    class TreeCheck : public IVisitor
+    {
+    public:
+        void check( const NodeList<Stmt*>& statements )
+        {
+            for ( auto&& statement : statements )
+            {
+                check( statement );
+            }
+        }
+
+        std::size_t getNodeCount() const
+        {
+            return m_nodes;
+        }
+
+        const char* getProblem() const
+        {
+            return m_problem;
+        }
+
+        void visit( Block* stmt ) override
+        {
+            check( stmt->statements );
+        }
+
+        void visit( ClassStmt* stmt ) override
+        {
+            if ( stmt->superclass )
+                check( stmt->superclass );
+
+            for ( auto&& method : stmt->methods )
+            {
+                check( method );
+            }
+        }
+
+        void visit( Expression* stmt ) override
+        {
+            check( stmt->expression );
+        }
+
+        void visit( Function* stmt ) override
+        {
+            check( stmt->body );
+        }
+
+        void visit( If* stmt ) override
+        {
+            check( stmt->condition );
+            check( stmt->thenBranch );
+            if ( stmt->elseBranch )
+                check( stmt->elseBranch );
+        }
+
+        void visit( Print* stmt ) override
+        {
+            check( stmt->expression );
+        }
+
+        void visit( Return* stmt ) override
+        {
+            if ( stmt->tailCall && stmt->tailCall != stmt->value )
+                report( "tail call is not the returned value" );
+
+            if ( stmt->value )
+                check( stmt->value );
+        }
+
+        void visit( Var* stmt ) override
+        {
+            if ( stmt->initializer )
+                check( stmt->initializer );
+        }
+
+        void visit( While* stmt ) override
+        {
+            check( stmt->condition );
+            check( stmt->body );
+        }
+
+        void visit( Assign* expr ) override
+        {
+            check( expr->value );
+        }
+
+        void visit( Binary* expr ) override
+        {
+            check( expr->left );
+            check( expr->right );
+        }
+
+        void visit( Call* expr ) override
+        {
+            if ( expr->property && expr->property != expr->callee )
+                report( "call property is not its callee" );
+
+            check( expr->callee );
+            for ( auto&& argument : expr->arguments )
+            {
+                check( argument );
+            }
+        }
+
+        void visit( Get* expr ) override
+        {
+            check( expr->object );
+        }
+
+        void visit( Grouping* expr ) override
+        {
+            check( expr->expr );
+        }
+
+        void visit( Literal* ) override
+        {
+        }
+
+        void visit( Logical* expr ) override
+        {
+            check( expr->left );
+            check( expr->right );
+        }
+
+        void visit( Set* expr ) override
+        {
+            check( expr->object );
+            check( expr->value );
+        }
+
+        void visit( Super* ) override
+        {
+        }
+
+        void visit( This* ) override
+        {
+        }
+
+        void visit( Unary* expr ) override
+        {
+            check( expr->right );
+        }
+
+        void visit( Variable* ) override
+        {
+        }
+
+    private:
+        template <typename Node>
+        void check( Node* node )
+        {
+            if ( !node )
+                return report( "missing child node" );
+            if ( !m_seen.insert( node ).second )
+                return report( "node shared between two parents" );
+
+            ++m_nodes;
+            node->accept( this );
+        }
+
+        void report( const char* problem )
+        {
+            if ( !m_problem )
+                m_problem = problem;
+        }
+
+        std::size_t m_nodes{ 0 };
+        const char* m_problem{ nullptr };
+        std::unordered_set<const void*> m_seen{};
+    };
+
+    Passes::PassStats& statsFor( const char* name )
+    {
+        for ( Passes::PassStats& stats : Passes::stats )
+        {
+            if ( std::strcmp( stats.name, name ) == 0 )
+                return stats;
+        }
+        return Passes::stats.emplace_back( Passes::PassStats{ name } );
+    }
+
+    std::size_t checkTree( const Pass& pass,
+                           const NodeList<Stmt*>& statements )
+    {
+        TreeCheck check{};
+        check.check( statements );
+
+        if ( check.getProblem() )
+        {
+            std::cerr << "[passes] " << pass.getName()
+                      << " left a malformed tree: " << check.getProblem()
+                      << '\n';
+            std::abort();
+        }
+
+        return check.getNodeCount();
+    }
+} // namespace
+
+PassManager::PassManager( Arena& arena, bool interactive )
+{
+    if ( Passes::config.level >= 1 )
+        m_passes.push_back(
+            std::make_unique<ConstantFolder>( arena, !interactive ) );
+
+    if ( Passes::config.level >= 2 )
+        m_passes.push_back( std::make_unique<DeadCodeEliminator>() );
+}
+
+void PassManager::run( NodeList<Stmt*>& statements )
+{
+#ifdef CPPLOX_VERIFY_PASSES
+    constexpr bool verify = true;
+#else
+    constexpr bool verify = false;
+#endif
+
+    for ( const auto& pass : m_passes )
+    {
+        if ( !Passes::config.stats && !verify )
+        {
+            pass->run( statements );
+            continue;
+        }
+
+        std::size_t nodesBefore = checkTree( *pass, statements );
+        auto start = std::chrono::steady_clock::now();
+
+        pass->run( statements );
+
+        double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start )
+                             .count();
+        std::size_t nodesAfter = checkTree( *pass, statements );
+
+        Passes::PassStats& stats = statsFor( pass->getName() );
+        ++stats.runs;
+        stats.nodesBefore += nodesBefore;
+        stats.nodesAfter += nodesAfter;
+        stats.seconds += seconds;
+    }
+}
+
+void Passes::printStats( std::ostream& out )
+{
+    for ( const PassStats& pass : stats )
+    {
+        long long delta = static_cast<long long>( pass.nodesAfter ) -
+                          static_cast<long long>( pass.nodesBefore );
+
+        out << "[passes] " << pass.name << ": " << pass.runs << " runs, "
+            << pass.nodesBefore << " -> " << pass.nodesAfter << " nodes ("
+            << ( delta > 0 ? "+" : "" ) << delta
+            << "), time: " << pass.seconds * 1000.0 << " ms\n";
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "Arena.h"
+
+struct Stmt;
+
+// A transformation of a resolved program, run between the Resolver and the
+// backends. Passes rewrite the tree in place and allocate any new nodes in
+// the program's Arena.
+class Pass
+{
+public:
+    virtual ~Pass() = default;
+    virtual const char* getName() const = 0;
+    virtual void run( NodeList<Stmt*>& statements ) = 0;
+};
+
+// Runs the passes selected by Passes::config.level, in order. Builds with
+// CPPLOX_VERIFY_PASSES, which Debug builds turn on, check that the tree is
+// still well formed after each pass.
+class PassManager
+{
+public:
+    PassManager( Arena& arena, bool interactive );
+
+    void run( NodeList<Stmt*>& statements );
+
+private:
+    std::vector<std::unique_ptr<Pass>> m_passes{};
+};
+
+namespace Passes
+{
+    struct Config
+    {
+        // -O0 runs no passes, -O1 folds constants, and -O2 also removes
+        // unreachable statements.
+        int level{ 1 };
+
+        // Times each pass and counts the nodes it adds or removes.
+        bool stats{ false };
+    };
+
+    struct PassStats
+    {
+        const char* name;
+        std::size_t runs{ 0 };
+        std::size_t nodesBefore{ 0 };
+        std::size_t nodesAfter{ 0 };
+        double seconds{ 0.0 };
+    };
+
+    inline Config config{};
+    inline std::vector<PassStats> stats{};
+
+    void printStats( std::ostream& out );
+} // namespace Passes
@@ -0,0 +1,46 @@
+#include <cstddef>
+#include <new>
+#include <ostream>
+
+#include "Pool.h"
+
+void* Pool::refill( std::size_t index )
+{
+    SizeClass& sizeClass = classes[index];
+    std::size_t blockSize = ( index + 1 ) * GRANULARITY;
+
+    // The first block of every chunk links the chunks of the class together,
+    // so they stay reachable for leak checkers.
+    auto* chunk = static_cast<std::byte*>( ::operator new( CHUNK_SIZE ) );
+    *reinterpret_cast<void**>( chunk ) = sizeClass.chunks;
+    sizeClass.chunks = chunk;
+    ++sizeClass.stats.chunks;
+
+    std::size_t count = CHUNK_SIZE / blockSize;
+    for ( std::size_t i = count - 1; i > 0; --i )
+    {
+        void* block = chunk + i * blockSize;
+        *static_cast<void**>( block ) = sizeClass.free;
+        sizeClass.free = block;
+    }
+
+    return sizeClass.free;
+}
+
+void Pool::printStats( std::ostream& out )
+{
+    for ( std::size_t i = 0; i < CLASSES; ++i )
+    {
+        const ClassStats& stats = classes[i].stats;
+        if ( stats.chunks == 0 )
+            continue;
+
+        std::size_t blockSize = ( i + 1 ) * GRANULARITY;
+        std::size_t capacity = stats.chunks * ( CHUNK_SIZE / blockSize - 1 );
+
+        out << "[pool] " << blockSize << " B: " << stats.live << '/'
+            << capacity << " live (peak " << stats.peak << "), "
+            << stats.chunks << " chunks, " << stats.allocations
+            << " allocations\n";
+    }
+}
\ No newline at end of file
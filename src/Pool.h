@@ -0,0 +1,83 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <ostream>
+
+// Size-class allocator for heap objects. Cells, functions, bound methods
+// and instances are created and freed at a very high rate, so each
+// size class keeps a free list of fixed-size blocks carved from larger
+// chunks. Freed blocks are reused by the next allocation of that class and
+// chunks are never returned to the system.
+//
+// The free lists are thread-local, so the common path takes no lock.
+// Requests larger than the biggest class go to the global operator new.
+namespace Pool
+{
+    constexpr std::size_t GRANULARITY = 16;
+    constexpr std::size_t MAX_SIZE = 256;
+    constexpr std::size_t CLASSES = MAX_SIZE / GRANULARITY;
+    constexpr std::size_t CHUNK_SIZE = 64 * 1024;
+
+    struct ClassStats
+    {
+        std::size_t chunks{ 0 };
+        std::size_t live{ 0 };
+        std::size_t peak{ 0 };
+        std::size_t allocations{ 0 };
+    };
+
+    struct SizeClass
+    {
+        void* free{ nullptr };
+        void* chunks{ nullptr };
+        ClassStats stats{};
+    };
+
+    // Plain data so it is usable until the thread is gone, including by
+    // objects released from static destructors.
+    inline thread_local std::array<SizeClass, CLASSES> classes{};
+
+    // Carves a new chunk into blocks for the given class and returns the
+    // first of them.
+    void* refill( std::size_t index );
+
+    inline void* allocate( std::size_t size )
+    {
+        if ( size > MAX_SIZE )
+            return ::operator new( size );
+
+        SizeClass& sizeClass = classes[( size - 1 ) / GRANULARITY];
+        void* block = sizeClass.free;
+        if ( !block )
+            block = refill( ( size - 1 ) / GRANULARITY );
+
+        sizeClass.free = *static_cast<void**>( block );
+
+        ClassStats& stats = sizeClass.stats;
+        ++stats.allocations;
+        if ( ++stats.live > stats.peak )
+            stats.peak = stats.live;
+
+        return block;
+    }
+
+    inline void deallocate( void* block, std::size_t size )
+    {
+        if ( size > MAX_SIZE )
+        {
+            ::operator delete( block );
+            return;
+        }
+
+        SizeClass& sizeClass = classes[( size - 1 ) / GRANULARITY];
+        *static_cast<void**>( block ) = sizeClass.free;
+        sizeClass.free = block;
+        --sizeClass.stats.live;
+    }
+
+    // Occupancy of the calling thread's pools, one line per size class in
+    // use.
+    void printStats( std::ostream& out );
+} // namespace Pool
\ No newline at end of file
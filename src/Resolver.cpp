@@ -1,18 +1,16 @@
-#include <memory>
 #include <vector>
 
 #include "Error.h"
 #include "Expression.h"
-#include "Interpreter.h"
 #include "Resolver.h"
 #include "Statement.h"
 #include "Token.h"
 
-void Resolver::resolve( const std::vector<std::unique_ptr<Stmt>>& statements )
+void Resolver::resolve( const NodeList<Stmt*>& statements )
 {
     for ( auto&& statement : statements )
     {
-        resolve( statement.get() );
+        resolve( statement );
     }
 }
 
@@ -28,40 +26,35 @@ void Resolver::visit( ClassStmt* stmt )
     ClassType enclosingClass = m_currentClass;
     m_currentClass = ClassType::CLASS;
 
-    declare( stmt->name );
+    declare( stmt->name, &stmt->captured );
     define( stmt->name );
 
-    if ( stmt->superclass.get() &&
-         stmt->name.getLexeme() == stmt->superclass->name.getLexeme() )
+    if ( stmt->superclass &&
+         stmt->name.getSymbol() == stmt->superclass->name.getSymbol() )
         Error::error( stmt->superclass->name,
                       "A class can't inherit from itself." );
 
-    if ( stmt->superclass.get() )
+    if ( stmt->superclass )
     {
         m_currentClass = ClassType::SUBCLASS;
-        resolve( stmt->superclass.get() );
+        resolve( stmt->superclass );
     }
 
-    if ( stmt->superclass.get() )
+    if ( stmt->superclass )
     {
         beginScope();
-        m_scopes.back().emplace( "super", true );
+        m_scopes.back().emplace( Symbols::SUPER, Local{ true, 0 } );
     }
 
-    beginScope();
-    m_scopes.back().emplace( "this", true );
-
     for ( auto&& method : stmt->methods )
     {
         FunctionType declaration = FunctionType::METHOD;
-        if ( method->name.getLexeme() == "init" )
+        if ( method->name.getSymbol() == Symbols::INIT )
             declaration = FunctionType::INITIALIZER;
-        resolveFunction( method.get(), declaration );
+        resolveFunction( method, declaration );
     }
 
-    endScope();
-
-    if ( stmt->superclass.get() )
+    if ( stmt->superclass )
         endScope();
 
     m_currentClass = enclosingClass;
@@ -69,12 +62,12 @@ void Resolver::visit( ClassStmt* stmt )
 
 void Resolver::visit( Expression* stmt )
 {
-    resolve( stmt->expression.get() );
+    resolve( stmt->expression );
 }
 
 void Resolver::visit( Function* stmt )
 {
-    declare( stmt->name );
+    declare( stmt->name, &stmt->captured );
     define( stmt->name );
 
     resolveFunction( stmt, FunctionType::FUNCTION );
@@ -82,15 +75,15 @@ void Resolver::visit( Function* stmt )
 
 void Resolver::visit( If* stmt )
 {
-    resolve( stmt->condition.get() );
-    resolve( stmt->thenBranch.get() );
-    if ( stmt->elseBranch.get() )
-        resolve( stmt->elseBranch.get() );
+    resolve( stmt->condition );
+    resolve( stmt->thenBranch );
+    if ( stmt->elseBranch )
+        resolve( stmt->elseBranch );
 }
 
 void Resolver::visit( Print* stmt )
 {
-    resolve( stmt->expression.get() );
+    resolve( stmt->expression );
 }
 
 void Resolver::visit( Return* stmt )
@@ -100,61 +93,63 @@ void Resolver::visit( Return* stmt )
         Error::error( stmt->keyword, "Can't return from top-level code." );
     }
 
-    if ( stmt->value.get() )
+    if ( stmt->value )
     {
         if ( m_currentFunction == FunctionType::INITIALIZER )
             Error::error( stmt->keyword,
                           "Can't return a value from an initializer." );
-        resolve( stmt->value.get() );
+        else
+            stmt->tailCall = dynamic_cast<Call*>( stmt->value );
+        resolve( stmt->value );
     }
 }
 
 void Resolver::visit( Var* stmt )
 {
-    declare( stmt->name );
-    if ( stmt->initializer.get() )
+    declare( stmt->name, &stmt->captured );
+    if ( stmt->initializer )
     {
-        resolve( stmt->initializer.get() );
+        resolve( stmt->initializer );
     }
     define( stmt->name );
 }
 
 void Resolver::visit( While* stmt )
 {
-    resolve( stmt->condition.get() );
-    resolve( stmt->body.get() );
+    resolve( stmt->condition );
+    resolve( stmt->body );
 }
 
 void Resolver::visit( Assign* expr )
 {
-    resolve( expr->value.get() );
-    resolveLocal( expr, expr->name );
+    resolve( expr->value );
+    resolveLocal( expr->location, expr->name.getSymbol() );
 }
 
 void Resolver::visit( Binary* expr )
 {
-    resolve( expr->left.get() );
-    resolve( expr->right.get() );
+    resolve( expr->left );
+    resolve( expr->right );
 }
 
 void Resolver::visit( Call* expr )
 {
-    resolve( expr->callee.get() );
+    resolve( expr->callee );
 
     for ( auto&& argument : expr->arguments )
     {
-        resolve( argument.get() );
+        resolve( argument );
     }
 }
 
 void Resolver::visit( Get* expr )
 {
-    resolve( expr->object.get() );
+    resolve( expr->object );
 }
 
 void Resolver::visit( Grouping* expr )
 {
-    resolve( expr->expr.get() );
+    resolve( expr->expr );
 }
 
 void Resolver::visit( Literal* )
@@ -164,14 +159,14 @@ void Resolver::visit( Literal* )
 
 void Resolver::visit( Logical* expr )
 {
-    resolve( expr->left.get() );
-    resolve( expr->right.get() );
+    resolve( expr->left );
+    resolve( expr->right );
 }
 
 void Resolver::visit( Set* expr )
 {
-    resolve( expr->value.get() );
-    resolve( expr->object.get() );
+    resolve( expr->value );
+    resolve( expr->object );
 }
 
 void Resolver::visit( Super* expr )
@@ -182,7 +177,8 @@ void Resolver::visit( Super* expr )
         Error::error( expr->keyword,
                       "Can't use 'super' in a class with no superclass." );
 
-    resolveLocal( expr, expr->keyword );
+    resolveLocal( expr->location, Symbols::SUPER );
+    resolveLocal( expr->thisLocation, Symbols::THIS );
 }
 
 void Resolver::visit( This* expr )
@@ -193,26 +189,25 @@ void Resolver::visit( This* expr )
         return;
     }
 
-    resolveLocal( expr, expr->keyword );
+    resolveLocal( expr->location, Symbols::THIS );
 }
 
 void Resolver::visit( Unary* expr )
 {
-    resolve( expr->right.get() );
+    resolve( expr->right );
 }
 
 void Resolver::visit( Variable* expr )
 {
-    if ( !m_scopes.empty() &&
-         m_scopes.back().find( expr->name.getLexeme() ) !=
-             m_scopes.back().end() &&
-         m_scopes.back().at( expr->name.getLexeme() ) == false )
+    if ( !m_scopes.empty() )
     {
-        Error::error( expr->name,
-                      "Can't read local variable in its own initializer." );
+        auto local = m_scopes.back().find( expr->name.getSymbol() );
+        if ( local != m_scopes.back().end() && !local->second.defined )
+            Error::error( expr->name,
+                          "Can't read local variable in its own initializer." );
     }
 
-    resolveLocal( expr, expr->name );
+    resolveLocal( expr->location, expr->name.getSymbol() );
 }
 
 void Resolver::resolve( Stmt* stmt )
@@ -227,27 +222,44 @@ void Resolver::resolve( Expr* expr )
 
 void Resolver::beginScope()
 {
-    m_scopes.emplace_back( std::map<std::string, bool>{} );
+    m_scopes.emplace_back( std::unordered_map<Symbol, Local>{} );
 }
 
 void Resolver::endScope()
 {
+    // Uses resolved before a closure captured the variable were told to
+    // read its slot directly; now that the whole scope has been seen, point
+    // them at the cell instead.
+    for ( auto& [name, local] : m_scopes.back() )
+    {
+        if ( !local.captured )
+            continue;
+
+        for ( Location* use : local.uses )
+            use->captured = true;
+        if ( local.declaration )
+            *local.declaration = true;
+    }
+
     m_scopes.pop_back();
 }
 
-void Resolver::declare( const Token& name )
+void Resolver::declare( const Token& name, bool* captured )
 {
     if ( m_scopes.empty() )
         return;
 
-    std::map<std::string, bool>& scope = m_scopes.back();
-    if ( scope.find( name.getLexeme() ) != scope.end() )
+    std::unordered_map<Symbol, Local>& scope = m_scopes.back();
+    if ( scope.find( name.getSymbol() ) != scope.end() )
     {
         Error::error( name,
                       "Already a variable with this name in this scope." );
     }
 
-    scope.emplace( name.getLexeme(), false );
+    // Slots are handed out in declaration order, which is the order the
+    // Interpreter defines them in at runtime.
+    scope.emplace( name.getSymbol(),
+                   Local{ false, static_cast<int>( scope.size() ), captured } );
 }
 
 void Resolver::define( const Token& name )
@@ -255,20 +267,73 @@ void Resolver::define( const Token& name )
     if ( m_scopes.empty() )
         return;
 
-    m_scopes.back()[name.getLexeme()] = true;
+    m_scopes.back().at( name.getSymbol() ).defined = true;
 }
 
-void Resolver::resolveLocal( Expr* expr, const Token& name )
+void Resolver::resolveLocal( Location& location, Symbol name )
 {
-    for ( int i = static_cast<int>( m_scopes.size() - 1 ); i >= 0; --i )
+    std::size_t firstScope = m_functions.back().firstScope;
+    for ( std::size_t i = m_scopes.size(); i-- > firstScope; )
     {
-        if ( m_scopes[i].find( name.getLexeme() ) != m_scopes[i].end() )
+        auto local = m_scopes[i].find( name );
+        if ( local != m_scopes[i].end() )
         {
-            m_interpreter.resolve(
-                expr, static_cast<int>( m_scopes.size() - 1 - i ) );
+            location.depth = static_cast<int>( m_scopes.size() - 1 - i );
+            location.slot = local->second.slot;
+            local->second.uses.push_back( &location );
             return;
         }
     }
+
+    int capture = resolveCapture( m_functions.size() - 1, name );
+    if ( capture >= 0 )
+    {
+        location.depth = Location::UPVALUE;
+        location.slot = capture;
+    }
+}
+
+int Resolver::resolveCapture( std::size_t function, Symbol name )
+{
+    if ( function == 0 )
+        return -1;
+
+    // Look through the scopes of the enclosing function that were open
+    // where this one is declared.
+    const FunctionScope& inner = m_functions[function];
+    std::size_t firstScope = m_functions[function - 1].firstScope;
+    for ( std::size_t i = inner.firstScope; i-- > firstScope; )
+    {
+        auto local = m_scopes[i].find( name );
+        if ( local != m_scopes[i].end() )
+        {
+            local->second.captured = true;
+            return addCapture(
+                inner.function,
+                Location{ static_cast<int>( inner.firstScope - 1 - i ),
+                          local->second.slot } );
+        }
+    }
+
+    int capture = resolveCapture( function - 1, name );
+    if ( capture < 0 )
+        return -1;
+
+    return addCapture( inner.function, Location{ Location::UPVALUE, capture } );
+}
+
+int Resolver::addCapture( Function* function, const Location& location )
+{
+    std::vector<Location>& captures = function->captures;
+    for ( std::size_t i = 0; i < captures.size(); ++i )
+    {
+        if ( captures[i].depth == location.depth &&
+             captures[i].slot == location.slot )
+            return static_cast<int>( i );
+    }
+
+    captures.push_back( location );
+    return static_cast<int>( captures.size() - 1 );
 }
 
 void Resolver::resolveFunction( Function* function, FunctionType type )
@@ -276,8 +341,14 @@ void Resolver::resolveFunction( Function* function, FunctionType type )
     FunctionType enclosingFunction = m_currentFunction;
     m_currentFunction = type;
 
+    m_functions.push_back( { function, m_scopes.size() } );
     beginScope();
 
+    // A method's receiver is the first slot of its own scope, so calling it
+    // does not need an extra environment just to hold this.
+    if ( type == FunctionType::METHOD || type == FunctionType::INITIALIZER )
+        m_scopes.back().emplace( Symbols::THIS, Local{ true, 0 } );
+
     for ( const auto& param : function->params )
     {
         declare( param );
@@ -285,7 +356,15 @@ void Resolver::resolveFunction( Function* function, FunctionType type )
     }
 
     resolve( function->body );
+
+    for ( const auto& [name, local] : m_scopes.back() )
+    {
+        if ( local.captured && !local.declaration )
+            function->capturedSlots.push_back( local.slot );
+    }
+
     endScope();
+    m_functions.pop_back();
 
     m_currentFunction = enclosingFunction;
 }
@@ -1,14 +1,13 @@
 #pragma once
-#include <map>
-#include <memory>
 #include <stack>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "Expression.h"
+#include "Symbol.h"
 #include "Visitor.h"
 
-class Interpreter;
 class Token;
 struct Expr;
 struct Stmt;
@@ -16,11 +15,9 @@ struct Stmt;
 class Resolver : public IVisitor
 {
 public:
-    Resolver( Interpreter& interpreter ) : m_interpreter{ interpreter }
-    {
-    }
+    Resolver() = default;
 
-    void resolve( const std::vector<std::unique_ptr<Stmt>>& statements );
+    void resolve( const NodeList<Stmt*>& statements );
     void visit( Block* stmt ) override;
     void visit( ClassStmt* stmt ) override;
     void visit( Expression* stmt ) override;
@@ -60,17 +57,42 @@ private:
         SUBCLASS
     };
 
+    struct Local
+    {
+        bool defined;
+        int slot;
+
+        // The declaration's flag to set if a closure captures the variable,
+        // or nullptr for the receiver, parameters and 'super'.
+        bool* declaration{ nullptr };
+        bool captured{ false };
+
+        // Every location resolved to this variable, so they can be pointed
+        // at its cell once the scope ends.
+        std::vector<Location*> uses{};
+    };
+
+    // A function being resolved, and the first of m_scopes that is its own.
+    // The bottom entry stands for the top-level code.
+    struct FunctionScope
+    {
+        Function* function;
+        std::size_t firstScope;
+    };
+
     void resolve( Stmt* stmt );
     void resolve( Expr* expr );
     void beginScope();
     void endScope();
-    void declare( const Token& name );
+    void declare( const Token& name, bool* captured = nullptr );
     void define( const Token& name );
-    void resolveLocal( Expr* expr, const Token& name );
+    void resolveLocal( Location& location, Symbol name );
+    int resolveCapture( std::size_t function, Symbol name );
+    int addCapture( Function* function, const Location& location );
     void resolveFunction( Function* function, FunctionType type );
 
-    Interpreter& m_interpreter;
-    std::vector<std::map<std::string, bool>> m_scopes{};
+    std::vector<std::unordered_map<Symbol, Local>> m_scopes{};
+    std::vector<FunctionScope> m_functions{ { nullptr, 0 } };
     FunctionType m_currentFunction{ FunctionType::NONE };
     ClassType m_currentClass{ ClassType::NONE };
 };
@@ -1,4 +1,6 @@
 #include <string>
+#include <string_view>
+#include <utility>
 #include <variant>
 
 #include "Error.h"
@@ -220,8 +222,9 @@ void Scanner::addToken( TokenType::Type type )
 
 void Scanner::addToken( TokenType::Type type, Object literal )
 {
-    std::string text = m_source.substr( m_start, m_current - m_start );
-    m_tokens.push_back( Token{ type, text, literal, m_line } );
+    std::string_view text =
+        std::string_view{ m_source }.substr( m_start, m_current - m_start );
+    m_tokens.emplace_back( type, text, literal, m_line );
 }
 
 std::vector<Token> Scanner::scanTokens()
@@ -233,7 +236,6 @@ std::vector<Token> Scanner::scanTokens()
         scanToken();
     }
 
-    m_tokens.push_back(
-        Token{ TokenType::LOX_EOF, "", std::monostate{}, m_line } );
-    return m_tokens;
+    m_tokens.emplace_back( TokenType::LOX_EOF, "", std::monostate{}, m_line );
+    return std::move( m_tokens );
 }
\ No newline at end of file
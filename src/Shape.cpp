@@ -0,0 +1,48 @@
+#include <cstdint>
+#include <memory>
+
+#include "Shape.h"
+#include "Symbol.h"
+
+Shape::Shape( const Shape& parent, Symbol name ) : m_names{ parent.m_names }
+{
+    m_names.push_back( name );
+
+    if ( m_names.size() > INDEX_THRESHOLD )
+    {
+        for ( std::uint32_t slot = 0; slot < m_names.size(); ++slot )
+            m_index.emplace( m_names[slot], slot );
+    }
+}
+
+Shape* Shape::empty()
+{
+    static Shape root{};
+    return &root;
+}
+
+std::uint32_t Shape::lookup( Symbol name ) const
+{
+    if ( !m_index.empty() )
+    {
+        auto slot = m_index.find( name );
+        return slot == m_index.end() ? NOT_FOUND : slot->second;
+    }
+
+    for ( std::uint32_t slot = 0; slot < m_names.size(); ++slot )
+    {
+        if ( m_names[slot] == name )
+            return slot;
+    }
+
+    return NOT_FOUND;
+}
+
+Shape* Shape::withField( Symbol name )
+{
+    std::unique_ptr<Shape>& next = m_transitions[name];
+    if ( !next )
+        next.reset( new Shape{ *this, name } );
+
+    return next.get();
+}
\ No newline at end of file
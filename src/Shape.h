@@ -0,0 +1,76 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Symbol.h"
+
+// The field layout of an instance: which name lives in which slot of its
+// field array. Instances that gained the same fields in the same order share
+// one shape. Shapes form a tree rooted at the empty shape, and adding a field
+// follows (or creates) a transition to a child. Shapes live until exit.
+class Shape
+{
+public:
+    static constexpr std::uint32_t NOT_FOUND = UINT32_MAX;
+
+    static Shape* empty();
+
+    std::uint32_t lookup( Symbol name ) const;
+    Shape* withField( Symbol name );
+
+    std::uint32_t getFieldCount() const
+    {
+        return static_cast<std::uint32_t>( m_names.size() );
+    }
+
+private:
+    // Small shapes are searched linearly, larger ones get an index.
+    static constexpr std::size_t INDEX_THRESHOLD = 8;
+
+    Shape() = default;
+    Shape( const Shape& parent, Symbol name );
+
+    std::vector<Symbol> m_names{};
+    std::unordered_map<Symbol, std::uint32_t> m_index{};
+    std::unordered_map<Symbol, std::unique_ptr<Shape>> m_transitions{};
+};
+
+// Inline cache of a property access site. It remembers the slot for the
+// first few shapes seen there, and for stores also the transition taken
+// when the field was added. A site that sees more shapes than it has room
+// for keeps the entries it has and falls back to lookups.
+struct FieldCache
+{
+    static constexpr std::size_t WAYS = 4;
+
+    struct Entry
+    {
+        Shape* shape{ nullptr };
+        Shape* transition{ nullptr };
+        std::uint32_t slot{ 0 };
+    };
+
+    const Entry* find( const Shape* shape ) const
+    {
+        for ( std::size_t i = 0; i < size; ++i )
+        {
+            if ( entries[i].shape == shape )
+                return &entries[i];
+        }
+
+        return nullptr;
+    }
+
+    void add( const Entry& entry )
+    {
+        if ( size < WAYS )
+            entries[size++] = entry;
+    }
+
+    std::array<Entry, WAYS> entries{};
+    std::size_t size{ 0 };
+};
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+
+// A view of values that someone else owns and keeps in place while the view
+// is in use, standing in for std::span until the code moves past C++17.
+template <typename T>
+class Span
+{
+public:
+    Span() = default;
+
+    Span( T* data, std::size_t size ) : m_data{ data }, m_size{ size }
+    {
+    }
+
+    T* begin() const
+    {
+        return m_data;
+    }
+
+    T* end() const
+    {
+        return m_data + m_size;
+    }
+
+    T& operator[]( std::size_t index ) const
+    {
+        return m_data[index];
+    }
+
+    std::size_t size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+
+private:
+    T* m_data{ nullptr };
+    std::size_t m_size{ 0 };
+};
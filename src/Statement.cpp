@@ -1,47 +1,93 @@
+#include "Completion.h"
 #include "Statement.h"
 #include "Visitor.h"
 
-void Block::accept( IVisitor* visitor )
+void Block::accept( IStmtVisitor* visitor )
 {
     visitor->visit( this );
 }
 
-void ClassStmt::accept( IVisitor* visitor )
+Completion Block::accept( ICompletionVisitor* visitor )
+{
+    return visitor->visit( this );
+}
+
+void ClassStmt::accept( IStmtVisitor* visitor )
 {
     visitor->visit( this );
 }
 
-void Expression::accept( IVisitor* visitor )
+Completion ClassStmt::accept( ICompletionVisitor* visitor )
+{
+    return visitor->visit( this );
+}
+
+void Expression::accept( IStmtVisitor* visitor )
 {
     visitor->visit( this );
 }
 
-void Function::accept( IVisitor* visitor )
+Completion Expression::accept( ICompletionVisitor* visitor )
+{
+    return visitor->visit( this );
+}
+
+void Function::accept( IStmtVisitor* visitor )
 {
     visitor->visit( this );
 }
 
-void If::accept( IVisitor* visitor )
+Completion Function::accept( ICompletionVisitor* visitor )
+{
+    return visitor->visit( this );
+}
+
+void If::accept( IStmtVisitor* visitor )
 {
     visitor->visit( this );
 }
 
-void Print::accept( IVisitor* visitor )
+Completion If::accept( ICompletionVisitor* visitor )
+{
+    return visitor->visit( this );
+}
+
+void Print::accept( IStmtVisitor* visitor )
 {
     visitor->visit( this );
 }
 
-void Return::accept( IVisitor* visitor )
+Completion Print::accept( ICompletionVisitor* visitor )
+{
+    return visitor->visit( this );
+}
+
+void Return::accept( IStmtVisitor* visitor )
 {
     visitor->visit( this );
 }
 
-void Var::accept( IVisitor* visitor )
+Completion Return::accept( ICompletionVisitor* visitor )
+{
+    return visitor->visit( this );
+}
+
+void Var::accept( IStmtVisitor* visitor )
 {
     visitor->visit( this );
 }
 
-void While::accept( IVisitor* visitor )
+Completion Var::accept( ICompletionVisitor* visitor )
+{
+    return visitor->visit( this );
+}
+
+void While::accept( IStmtVisitor* visitor )
 {
     visitor->visit( this );
+}
+
+Completion While::accept( ICompletionVisitor* visitor )
+{
+    return visitor->visit( this );
 }
\ No newline at end of file
@@ -1,137 +1,175 @@
 #pragma once
+#include <cstdint>
 #include <functional>
 #include <iostream>
-#include <memory>
 #include <vector>
 
+#include "Completion.h"
 #include "Expression.h"
 #include "Visitor.h"
 
+class Interpreter;
+
+namespace Jit
+{
+    struct Code;
+} // namespace Jit
+
 struct Stmt
 {
-    virtual void accept( IVisitor* visitor ) = 0;
+    virtual void accept( IStmtVisitor* visitor ) = 0;
+    virtual Completion accept( ICompletionVisitor* visitor ) = 0;
     virtual ~Stmt() = default;
 };
 
 struct Block : public Stmt
 {
-    void accept( IVisitor* visitor ) override;
+    void accept( IStmtVisitor* visitor ) override;
+    Completion accept( ICompletionVisitor* visitor ) override;
 
-    Block( std::vector<std::unique_ptr<Stmt>> statements )
-        : statements{ std::move( statements ) }
+    Block( NodeList<Stmt*> statements ) : statements{ statements }
     {
     }
 
-    std::vector<std::unique_ptr<Stmt>> statements;
+    NodeList<Stmt*> statements;
 };
 
 struct ClassStmt : public Stmt
 {
-    void accept( IVisitor* visitor ) override;
+    void accept( IStmtVisitor* visitor ) override;
+    Completion accept( ICompletionVisitor* visitor ) override;
 
-    ClassStmt( const Token& name, std::unique_ptr<Variable> superclass,
-               std::vector<std::unique_ptr<Function>> methods )
-        : name{ name }, superclass{ std::move( superclass ) },
-          methods{ std::move( methods ) }
+    ClassStmt( const Token& name, Variable* superclass,
+               NodeList<Function*> methods )
+        : name{ name }, superclass{ superclass }, methods{ methods }
     {
     }
 
     Token name;
-    std::unique_ptr<Variable> superclass;
-    std::vector<std::unique_ptr<Function>> methods;
+    Variable* superclass;
+    NodeList<Function*> methods;
+    bool captured{ false };
 };
 
 struct Expression : public Stmt
 {
-    void accept( IVisitor* visitor ) override;
+    void accept( IStmtVisitor* visitor ) override;
+    Completion accept( ICompletionVisitor* visitor ) override;
 
-    Expression( std::unique_ptr<Expr> expression )
-        : expression{ std::move( expression ) }
+    Expression( Expr* expression ) : expression{ expression }
     {
     }
 
-    std::unique_ptr<Expr> expression;
+    Expr* expression;
 };
 
 struct Function : public Stmt
 {
-    void accept( IVisitor* visitor ) override;
+    void accept( IStmtVisitor* visitor ) override;
+    Completion accept( ICompletionVisitor* visitor ) override;
 
-    Function( const Token& name, const std::vector<Token>& params,
-              std::vector<std::unique_ptr<Stmt>> body )
-        : name{ name }, params{ std::move( params ) }, body{ std::move( body ) }
+    Function( const Token& name, NodeList<Token> params, NodeList<Stmt*> body )
+        : name{ name }, params{ params }, body{ body }
     {
     }
 
     Token name;
-    std::vector<Token> params;
-    std::vector<std::unique_ptr<Stmt>> body;
+    NodeList<Token> params;
+    NodeList<Stmt*> body;
+
+    // Filled in by the Resolver. The variables of enclosing functions the
+    // body refers to, located as they are where the function is declared;
+    // a closure captures their cells when it is created.
+    std::vector<Location> captures{};
+
+    // Slots of the receiver and parameters that are captured in turn, and
+    // are moved into cells when the function is called.
+    std::vector<int> capturedSlots{};
+
+    // The function's own name is captured.
+    bool captured{ false };
+
+    // The body as compiled by the ClosureCompiler, or empty when the
+    // tree-walker runs it, which for an empty body comes to the same.
+    std::vector<std::function<Completion( Interpreter& )>> compiledBody{};
+
+    // Kept by Jit::run: the calls counted so far, the machine code once the
+    // function is hot, and whether it turned out it cannot be compiled.
+    std::uint32_t calls{ 0 };
+    Jit::Code* jitCode{ nullptr };
+    bool jitFailed{ false };
 };
 
 struct If : public Stmt
 {
-    void accept( IVisitor* visitor ) override;
+    void accept( IStmtVisitor* visitor ) override;
+    Completion accept( ICompletionVisitor* visitor ) override;
 
-    If( std::unique_ptr<Expr> condition, std::unique_ptr<Stmt> thenBranch,
-        std::unique_ptr<Stmt> elseBranch )
-        : condition{ std::move( condition ) },
-          thenBranch{ std::move( thenBranch ) },
-          elseBranch{ std::move( elseBranch ) }
+    If( Expr* condition, Stmt* thenBranch, Stmt* elseBranch )
+        : condition{ condition }, thenBranch{ thenBranch },
+          elseBranch{ elseBranch }
     {
     }
 
-    std::unique_ptr<Expr> condition;
-    std::unique_ptr<Stmt> thenBranch;
-    std::unique_ptr<Stmt> elseBranch;
+    Expr* condition;
+    Stmt* thenBranch;
+    Stmt* elseBranch;
 };
 
 struct Print : public Stmt
 {
-    void accept( IVisitor* visitor ) override;
+    void accept( IStmtVisitor* visitor ) override;
+    Completion accept( ICompletionVisitor* visitor ) override;
 
-    Print( std::unique_ptr<Expr> expression )
-        : expression{ std::move( expression ) }
+    Print( Expr* expression ) : expression{ expression }
     {
     }
 
-    std::unique_ptr<Expr> expression;
+    Expr* expression;
 };
 
 struct Return : public Stmt
 {
-    void accept( IVisitor* visitor ) override;
+    void accept( IStmtVisitor* visitor ) override;
+    Completion accept( ICompletionVisitor* visitor ) override;
 
-    Return( const Token& keyword, std::unique_ptr<Expr> value )
-        : keyword{ keyword }, value{ std::move( value ) }
+    Return( const Token& keyword, Expr* value )
+        : keyword{ keyword }, value{ value }
     {
     }
 
     Token keyword;
-    std::unique_ptr<Expr> value;
+    Expr* value;
+
+    // Set by the Resolver when the value is a call in tail position, so the
+    // caller's frame can be reused for it.
+    Call* tailCall{ nullptr };
 };
 
 struct Var : public Stmt
 {
-    void accept( IVisitor* visitor ) override;
+    void accept( IStmtVisitor* visitor ) override;
+    Completion accept( ICompletionVisitor* visitor ) override;
 
-    Var( const Token& name, std::unique_ptr<Expr> initializer )
-        : name{ name }, initializer{ std::move( initializer ) }
+    Var( const Token& name, Expr* initializer )
+        : name{ name }, initializer{ initializer }
     {
     }
 
     Token name;
-    std::unique_ptr<Expr> initializer;
+    Expr* initializer;
+    bool captured{ false };
 };
 
 struct While : public Stmt
 {
-    void accept( IVisitor* visitor ) override;
+    void accept( IStmtVisitor* visitor ) override;
+    Completion accept( ICompletionVisitor* visitor ) override;
 
-    While( std::unique_ptr<Expr> condition, std::unique_ptr<Stmt> body )
-        : condition{ std::move( condition ) }, body{ std::move( body ) }
+    While( Expr* condition, Stmt* body ) : condition{ condition }, body{ body }
     {
     }
 
-    std::unique_ptr<Expr> condition;
-    std::unique_ptr<Stmt> body;
+    Expr* condition;
+    Stmt* body;
 };
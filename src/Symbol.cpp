@@ -0,0 +1,35 @@
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "Symbol.h"
+
+Symbol::Symbol() : m_entry{ intern( "" ) }
+{
+}
+
+Symbol::Symbol( std::string_view name ) : m_entry{ intern( name ) }
+{
+}
+
+const Symbol::Entry* Symbol::intern( std::string_view name )
+{
+    // Function statics, so symbols can be created during static
+    // initialization. Entries live in a deque, which never moves them, and
+    // the index keys are views into the stored names.
+    static std::deque<Entry> entries{};
+    static std::unordered_map<std::string_view, const Entry*> index{};
+
+    auto it = index.find( name );
+    if ( it != index.end() )
+        return it->second;
+
+    const Entry& entry = entries.emplace_back(
+        Entry{ std::string{ name }, std::hash<std::string_view>{}( name ),
+               static_cast<std::uint32_t>( entries.size() ) } );
+    index.emplace( entry.name, &entry );
+    return &entry;
+}
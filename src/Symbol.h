@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// An interned name. Every distinct spelling is stored once in a process-wide
+// table, so symbols compare by pointer and carry a precomputed hash. The
+// Scanner interns each lexeme, and environments, instances and classes key
+// their tables on symbols instead of strings.
+class Symbol
+{
+public:
+    Symbol();
+    explicit Symbol( std::string_view name );
+
+    const std::string& getName() const
+    {
+        return m_entry->name;
+    }
+
+    std::uint32_t getId() const
+    {
+        return m_entry->id;
+    }
+
+    std::size_t getHash() const
+    {
+        return m_entry->hash;
+    }
+
+    friend bool operator==( Symbol a, Symbol b )
+    {
+        return a.m_entry == b.m_entry;
+    }
+
+    friend bool operator!=( Symbol a, Symbol b )
+    {
+        return a.m_entry != b.m_entry;
+    }
+
+    friend bool operator<( Symbol a, Symbol b )
+    {
+        return a.m_entry->id < b.m_entry->id;
+    }
+
+private:
+    struct Entry
+    {
+        std::string name;
+        std::size_t hash;
+        std::uint32_t id;
+    };
+
+    static const Entry* intern( std::string_view name );
+
+    const Entry* m_entry;
+};
+
+template <>
+struct std::hash<Symbol>
+{
+    std::size_t operator()( Symbol symbol ) const noexcept
+    {
+        return symbol.getHash();
+    }
+};
+
+// Names the runtime looks up itself.
+namespace Symbols
+{
+    inline const Symbol CLOCK{ "clock" };
+    inline const Symbol INIT{ "init" };
+    inline const Symbol SUPER{ "super" };
+    inline const Symbol THIS{ "this" };
+} // namespace Symbols
@@ -20,11 +20,16 @@ std::ostream& operator<<( std::ostream& out, const Token& token )
 
 std::string Token::toString() const
 {
-    return std::string{ TokenType::getType( m_type ) + " " + m_lexeme + " " +
-                        literalToString() };
+    return std::string{ TokenType::getType( m_type ) + " " +
+                        m_lexeme.getName() + " " + literalToString() };
 }
 
-std::string Token::getLexeme() const
+const std::string& Token::getLexeme() const
+{
+    return m_lexeme.getName();
+}
+
+Symbol Token::getSymbol() const
 {
     return m_lexeme;
 }
@@ -51,27 +56,38 @@ const Object& Token::getLiteral() const
 
 std::string objectToString( const Object& obj )
 {
-    if ( obj.index() == 0 )
+    if ( obj.isNil() )
         return "null";
-    else if ( obj.index() == 1 )
-        return std::get<std::string>( obj );
-    else if ( obj.index() == 2 )
+    else if ( obj.isString() )
+        return obj.asString();
+    else if ( obj.isNumber() )
     {
-        std::string res = std::to_string( std::get<double>( obj ) );
+        std::string res = std::to_string( obj.asNumber() );
         res.erase( res.find_last_not_of( '0' ) + 1, std::string::npos );
         res.erase( res.find_last_not_of( '.' ) + 1, std::string::npos );
         return res;
     }
-    else if ( obj.index() == 3 )
+    else if ( obj.isBool() )
     {
-        return std::get<bool>( obj ) ? "true" : "false";
+        return obj.asBool() ? "true" : "false";
     }
-    else if ( obj.index() == 4 )
+    else if ( obj.isCallable() )
     {
-        return std::get<std::shared_ptr<LoxCallable>>( obj ).get()->toString();
+        return obj.as<LoxCallable>()->toString();
     }
     else
     {
-        return std::get<std::shared_ptr<LoxInstance>>( obj ).get()->toString();
+        return obj.as<LoxInstance>()->toString();
     }
-}
\ No newline at end of file
+}
+
+void printObject( std::ostream& out, const Object& obj )
+{
+    // Strings are written straight from the shared buffer.
+    if ( obj.isString() )
+        out << obj.asString();
+    else if ( obj.isNil() )
+        out << "nil";
+    else
+        out << objectToString( obj );
+}
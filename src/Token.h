@@ -2,10 +2,12 @@
 #include <array>
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <variant>
 
 #include "LoxCallable.h"
 #include "Object.h"
+#include "Symbol.h"
 
 namespace TokenType
 {
@@ -91,14 +93,16 @@ namespace TokenType
 class Token
 {
 public:
-    Token( TokenType::Type type, std::string lexeme, Object literal, int line )
+    Token( TokenType::Type type, std::string_view lexeme, Object literal,
+           int line )
         : m_type{ type }, m_lexeme{ lexeme }, m_literal{ literal },
           m_line{ line }
     {
     }
 
     std::string toString() const;
-    std::string getLexeme() const;
+    const std::string& getLexeme() const;
+    Symbol getSymbol() const;
     TokenType::Type getType() const;
     int getLine() const;
     friend std::ostream& operator<<( std::ostream& out, const Token& token );
@@ -107,7 +111,7 @@ public:
 private:
     std::string literalToString() const;
     const TokenType::Type m_type{ TokenType::MAX_TOKENTYPE };
-    const std::string m_lexeme{};
+    const Symbol m_lexeme{};
     const Object m_literal{ std::monostate{} };
     const int m_line{};
 };
\ No newline at end of file
@@ -0,0 +1,605 @@
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "Chunk.h"
+#include "Error.h"
+#include "LoxCallable.h"
+#include "LoxClock.h"
+#include "LoxInstance.h"
+#include "LoxString.h"
+#include "Object.h"
+#include "Symbol.h"
+#include "Token.h"
+#include "VM.h"
+#include "VMObject.h"
+
+namespace
+{
+    constexpr std::size_t INITIAL_STACK = 1024;
+    constexpr std::size_t MAX_FRAMES = 65536;
+} // namespace
+
+VM::VM( Interpreter& host ) : m_stack( INITIAL_STACK ), m_host{ host }
+{
+    m_frames.reserve( 64 );
+
+    GlobalTable::Slot& clock = m_globals[m_globals.indexOf( Symbols::CLOCK )];
+    clock.value = Object{ makeRef<LoxClock>() };
+    clock.defined = true;
+}
+
+void VM::interpret( std::shared_ptr<VMFunction> script )
+{
+    Ref<VMClosure> closure = makeRef<VMClosure>( script );
+
+    try
+    {
+        push( Object{ closure } );
+        call( closure.get(), 0 );
+        run();
+    }
+    catch ( const Error::RuntimeError& error )
+    {
+        Error::runtimeError( error );
+        resetStack();
+    }
+}
+
+GlobalTable& VM::getGlobals()
+{
+    return m_globals;
+}
+
+void VM::run()
+{
+    CallFrame* frame = &m_frames.back();
+    const Chunk* chunk = &frame->closure->function->chunk;
+
+    auto readByte = [&frame]() { return *frame->ip++; };
+    auto readShort = [&frame]() {
+        frame->ip += 2;
+        return static_cast<std::uint16_t>( ( frame->ip[-2] << 8 ) |
+                                           frame->ip[-1] );
+    };
+    auto readName = [&]() { return chunk->names[readShort()]; };
+    auto reloadFrame = [&]() {
+        frame = &m_frames.back();
+        chunk = &frame->closure->function->chunk;
+    };
+    auto checkNumbers = [this]() {
+        if ( !peek( 0 ).isNumber() || !peek( 1 ).isNumber() )
+            throw error( "Operands must be numbers." );
+    };
+
+    while ( true )
+    {
+        std::uint8_t instruction = readByte();
+        switch ( instruction )
+        {
+        case OpCode::CONSTANT:
+            push( chunk->constants[readShort()] );
+            break;
+        case OpCode::NIL:
+            push( Object{ std::monostate{} } );
+            break;
+        case OpCode::TRUE:
+            push( Object{ true } );
+            break;
+        case OpCode::FALSE:
+            push( Object{ false } );
+            break;
+        case OpCode::POP:
+            pop();
+            break;
+
+        case OpCode::GET_LOCAL:
+            push( m_stack[frame->base + readByte()] );
+            break;
+        case OpCode::SET_LOCAL:
+            m_stack[frame->base + readByte()] = peek( 0 );
+            break;
+        case OpCode::GET_GLOBAL:
+        {
+            std::uint16_t index = readShort();
+            GlobalTable::Slot& global = m_globals[index];
+            if ( !global.defined )
+                throw error( "Undefined variable '" +
+                             m_globals.getName( index ) + "'." );
+            push( global.value );
+            break;
+        }
+        case OpCode::DEFINE_GLOBAL:
+        {
+            GlobalTable::Slot& global = m_globals[readShort()];
+            global.value = pop();
+            global.defined = true;
+            break;
+        }
+        case OpCode::SET_GLOBAL:
+        {
+            std::uint16_t index = readShort();
+            GlobalTable::Slot& global = m_globals[index];
+            if ( !global.defined )
+                throw error( "Undefined variable '" +
+                             m_globals.getName( index ) + "'." );
+            global.value = peek( 0 );
+            break;
+        }
+        case OpCode::GET_UPVALUE:
+        {
+            VMUpvalue& upvalue = *frame->closure->upvalues[readByte()];
+            push( upvalue.isOpen ? m_stack[upvalue.slot] : upvalue.closed );
+            break;
+        }
+        case OpCode::SET_UPVALUE:
+        {
+            VMUpvalue& upvalue = *frame->closure->upvalues[readByte()];
+            if ( upvalue.isOpen )
+                m_stack[upvalue.slot] = peek( 0 );
+            else
+                upvalue.closed = peek( 0 );
+            break;
+        }
+        case OpCode::GET_PROPERTY:
+        {
+            if ( !peek( 0 ).isInstance() )
+                throw error( "Only instances have properties." );
+
+            Ref<LoxInstance> instance = peek( 0 ).asRef<LoxInstance>();
+            Symbol name = readName();
+
+            if ( Object* field = instance->findField( name ) )
+            {
+                peek( 0 ) = *field;
+                break;
+            }
+
+            bindMethod( static_cast<VMClass*>( instance->getClass() ), name );
+            break;
+        }
+        case OpCode::SET_PROPERTY:
+        {
+            if ( !peek( 1 ).isInstance() )
+                throw error( "Only instances have fields." );
+
+            peek( 1 ).as<LoxInstance>()->setField( readName(), peek( 0 ) );
+
+            Object value = pop();
+            peek( 0 ) = std::move( value );
+            break;
+        }
+        case OpCode::GET_SUPER:
+        {
+            Symbol name = readName();
+            Object superclass = pop();
+            bindMethod( superclass.as<VMClass>(), name );
+            break;
+        }
+
+        case OpCode::EQUAL:
+        {
+            Object b = pop();
+            peek( 0 ) = Object{ isEqual( peek( 0 ), b ) };
+            break;
+        }
+        case OpCode::NOT_EQUAL:
+        {
+            Object b = pop();
+            peek( 0 ) = Object{ !isEqual( peek( 0 ), b ) };
+            break;
+        }
+        case OpCode::GREATER:
+        {
+            checkNumbers();
+            double b = pop().asNumber();
+            peek( 0 ) = Object{ peek( 0 ).asNumber() > b };
+            break;
+        }
+        case OpCode::GREATER_EQUAL:
+        {
+            checkNumbers();
+            double b = pop().asNumber();
+            peek( 0 ) = Object{ peek( 0 ).asNumber() >= b };
+            break;
+        }
+        case OpCode::LESS:
+        {
+            checkNumbers();
+            double b = pop().asNumber();
+            peek( 0 ) = Object{ peek( 0 ).asNumber() < b };
+            break;
+        }
+        case OpCode::LESS_EQUAL:
+        {
+            checkNumbers();
+            double b = pop().asNumber();
+            peek( 0 ) = Object{ peek( 0 ).asNumber() <= b };
+            break;
+        }
+        case OpCode::ADD:
+        {
+            Object& a = peek( 1 );
+            const Object& b = peek( 0 );
+            if ( a.isNumber() && b.isNumber() )
+            {
+                a = Object{ a.asNumber() + b.asNumber() };
+            }
+            else if ( a.isString() && b.isString() )
+            {
+                a = Object{ LoxString::concat( a.asRef<LoxString>(),
+                                               b.asRef<LoxString>() ) };
+            }
+            else
+            {
+                throw error( "Operands must be two numbers or two strings." );
+            }
+            pop();
+            break;
+        }
+        case OpCode::SUBTRACT:
+        {
+            checkNumbers();
+            double b = pop().asNumber();
+            peek( 0 ) = Object{ peek( 0 ).asNumber() - b };
+            break;
+        }
+        case OpCode::MULTIPLY:
+        {
+            checkNumbers();
+            double b = pop().asNumber();
+            peek( 0 ) = Object{ peek( 0 ).asNumber() * b };
+            break;
+        }
+        case OpCode::DIVIDE:
+        {
+            checkNumbers();
+            double b = pop().asNumber();
+            peek( 0 ) = Object{ peek( 0 ).asNumber() / b };
+            break;
+        }
+        case OpCode::NOT:
+            peek( 0 ) = Object{ !isTruthy( peek( 0 ) ) };
+            break;
+        case OpCode::NEGATE:
+            if ( !peek( 0 ).isNumber() )
+                throw error( "Operand must be a number." );
+            peek( 0 ) = Object{ -peek( 0 ).asNumber() };
+            break;
+
+        case OpCode::PRINT:
+            printObject( std::cout, peek( 0 ) );
+            std::cout << '\n';
+            pop();
+            break;
+        case OpCode::JUMP:
+        {
+            std::uint16_t offset = readShort();
+            frame->ip += offset;
+            break;
+        }
+        case OpCode::JUMP_IF_FALSE:
+        {
+            std::uint16_t offset = readShort();
+            if ( !isTruthy( peek( 0 ) ) )
+                frame->ip += offset;
+            break;
+        }
+        case OpCode::LOOP:
+        {
+            std::uint16_t offset = readShort();
+            frame->ip -= offset;
+            break;
+        }
+        case OpCode::CALL:
+        {
+            int argCount = readByte();
+            callValue( peek( static_cast<std::size_t>( argCount ) ),
+                       argCount );
+            reloadFrame();
+            break;
+        }
+        case OpCode::INVOKE:
+        {
+            Symbol name = readName();
+            int argCount = readByte();
+            invoke( name, argCount );
+            reloadFrame();
+            break;
+        }
+        case OpCode::SUPER_INVOKE:
+        {
+            Symbol name = readName();
+            int argCount = readByte();
+            Object superclass = pop();
+            invokeFromClass( superclass.as<VMClass>(), name, argCount );
+            reloadFrame();
+            break;
+        }
+        case OpCode::CLOSURE:
+        {
+            Ref<VMClosure> closure =
+                makeRef<VMClosure>( chunk->functions[readShort()] );
+
+            for ( auto&& upvalue : closure->upvalues )
+            {
+                std::uint8_t isLocal = readByte();
+                std::uint8_t index = readByte();
+                if ( isLocal )
+                    upvalue = captureUpvalue( frame->base + index );
+                else
+                    upvalue = frame->closure->upvalues[index];
+            }
+
+            push( Object{ closure } );
+            break;
+        }
+        case OpCode::CLOSE_UPVALUE:
+            closeUpvalues( m_top - 1 );
+            pop();
+            break;
+        case OpCode::RETURN:
+        {
+            Object result = pop();
+            std::size_t base = frame->base;
+            closeUpvalues( base );
+            m_frames.pop_back();
+
+            truncate( base );
+            if ( m_frames.empty() )
+                return;
+
+            push( std::move( result ) );
+            reloadFrame();
+            break;
+        }
+
+        case OpCode::CLASS:
+            push( Object{ makeRef<VMClass>( readName().getName() ) } );
+            break;
+        case OpCode::INHERIT:
+        {
+            if ( !peek( 1 ).isKind( HeapObject::Kind::VM_CLASS ) )
+                throw error( "Superclass must be a class." );
+
+            VMClass* superclass = peek( 1 ).as<VMClass>();
+            VMClass* subclass = peek( 0 ).as<VMClass>();
+            subclass->methods = superclass->methods;
+            subclass->initializer = superclass->initializer;
+            pop();
+            break;
+        }
+        case OpCode::METHOD:
+            defineMethod( readName() );
+            break;
+
+        default:
+            throw error( "Unknown opcode." );
+        }
+    }
+}
+
+void VM::push( Object value )
+{
+    if ( m_top == m_stack.size() )
+        m_stack.resize( m_stack.size() * 2 );
+
+    m_stack[m_top++] = std::move( value );
+}
+
+Object VM::pop()
+{
+    Object value = std::move( m_stack[--m_top] );
+    m_stack[m_top] = std::monostate{};
+    return value;
+}
+
+Object& VM::peek( std::size_t distance )
+{
+    return m_stack[m_top - 1 - distance];
+}
+
+void VM::truncate( std::size_t top )
+{
+    while ( m_top > top )
+        m_stack[--m_top] = std::monostate{};
+}
+
+void VM::resetStack()
+{
+    // Closures that escaped the frames being unwound keep their variables.
+    closeUpvalues( 0 );
+    truncate( 0 );
+    m_frames.clear();
+}
+
+void VM::callValue( const Object& callee, int argCount )
+{
+    if ( !callee.isCallable() )
+        throw error( "Can only call functions and classes." );
+
+    LoxCallable* callable = callee.as<LoxCallable>();
+
+    switch ( callable->getKind() )
+    {
+    case HeapObject::Kind::VM_CLOSURE:
+        call( static_cast<VMClosure*>( callable ), argCount );
+        return;
+    case HeapObject::Kind::VM_BOUND_METHOD:
+    {
+        VMBoundMethod* bound = static_cast<VMBoundMethod*>( callable );
+        // The method outlives the bound object through the receiver's class.
+        VMClosure* method = bound->method.get();
+        m_stack[m_top - static_cast<std::size_t>( argCount ) - 1] =
+            bound->receiver;
+        call( method, argCount );
+        return;
+    }
+    case HeapObject::Kind::VM_CLASS:
+    {
+        VMClass* klass = static_cast<VMClass*>( callable );
+        m_stack[m_top - static_cast<std::size_t>( argCount ) - 1] =
+            Object{ makeRef<LoxInstance>( Ref<LoxClass>{ klass } ) };
+
+        if ( klass->initializer )
+        {
+            call( klass->initializer.get(), argCount );
+        }
+        else if ( argCount != 0 )
+        {
+            throw error( "Expected 0 arguments but got " +
+                         std::to_string( argCount ) + "." );
+        }
+        return;
+    }
+
+    default:
+        break;
+    }
+
+    if ( callable->arity() != argCount )
+    {
+        throw error( "Expected " + std::to_string( callable->arity() ) +
+                     " arguments but got " + std::to_string( argCount ) +
+                     "." );
+    }
+
+    // Keep the native alive while its arguments are popped.
+    Ref<LoxCallable> native = callee.asRef<LoxCallable>();
+    std::size_t count = static_cast<std::size_t>( argCount );
+    Object result = native->call(
+        m_host, Span<const Object>{ m_stack.data() + m_top - count, count } );
+
+    truncate( m_top - count - 1 );
+    push( std::move( result ) );
+}
+
+void VM::call( VMClosure* closure, int argCount )
+{
+    if ( argCount != closure->function->arity )
+    {
+        throw error( "Expected " + std::to_string( closure->function->arity ) +
+                     " arguments but got " + std::to_string( argCount ) +
+                     "." );
+    }
+
+    if ( m_frames.size() == MAX_FRAMES )
+        throw error( "Stack overflow." );
+
+    m_frames.push_back(
+        CallFrame{ closure, closure->function->chunk.code.data(),
+                   m_top - static_cast<std::size_t>( argCount ) - 1 } );
+}
+
+void VM::invoke( Symbol name, int argCount )
+{
+    Object& receiver = peek( static_cast<std::size_t>( argCount ) );
+    if ( !receiver.isInstance() )
+        throw error( "Only instances have properties." );
+
+    LoxInstance* instance = receiver.as<LoxInstance>();
+
+    if ( Object* field = instance->findField( name ) )
+    {
+        Object callee = *field;
+        receiver = callee;
+        callValue( callee, argCount );
+        return;
+    }
+
+    invokeFromClass( static_cast<VMClass*>( instance->getClass() ), name,
+                     argCount );
+}
+
+void VM::invokeFromClass( VMClass* klass, Symbol name, int argCount )
+{
+    auto method = klass->methods.find( name );
+    if ( method == klass->methods.end() )
+        throw error( "Undefined property '" + name.getName() + "'." );
+
+    call( method->second.get(), argCount );
+}
+
+void VM::bindMethod( VMClass* klass, Symbol name )
+{
+    auto method = klass->methods.find( name );
+    if ( method == klass->methods.end() )
+        throw error( "Undefined property '" + name.getName() + "'." );
+
+    peek( 0 ) =
+        Object{ makeRef<VMBoundMethod>( peek( 0 ), method->second ) };
+}
+
+Ref<VMUpvalue> VM::captureUpvalue( std::size_t slot )
+{
+    // Open upvalues are sorted by slot, and new captures are almost always
+    // near the top of the stack.
+    auto it = m_openUpvalues.end();
+    while ( it != m_openUpvalues.begin() &&
+            ( *std::prev( it ) )->slot >= slot )
+    {
+        --it;
+        if ( ( *it )->slot == slot )
+            return *it;
+    }
+
+    Ref<VMUpvalue> upvalue = makeRef<VMUpvalue>( slot );
+    m_openUpvalues.insert( it, upvalue );
+    return upvalue;
+}
+
+void VM::closeUpvalues( std::size_t last )
+{
+    while ( !m_openUpvalues.empty() && m_openUpvalues.back()->slot >= last )
+    {
+        VMUpvalue& upvalue = *m_openUpvalues.back();
+        upvalue.closed = m_stack[upvalue.slot];
+        upvalue.isOpen = false;
+        m_openUpvalues.pop_back();
+    }
+}
+
+void VM::defineMethod( Symbol name )
+{
+    Ref<VMClosure> method = peek( 0 ).asRef<VMClosure>();
+    VMClass* klass = peek( 1 ).as<VMClass>();
+
+    klass->methods.insert_or_assign( name, method );
+    if ( name == Symbols::INIT )
+        klass->initializer = method;
+
+    pop();
+}
+
+bool VM::isTruthy( const Object& object ) const
+{
+    if ( object.isNil() )
+        return false;
+    if ( object.isBool() )
+        return object.asBool();
+
+    return true;
+}
+
+bool VM::isEqual( const Object& a, const Object& b ) const
+{
+    // Same representation as the tree-walker: values of different types are
+    // never equal, callables and instances compare by identity.
+    return a == b;
+}
+
+Error::RuntimeError VM::error( const std::string& message ) const
+{
+    const CallFrame& frame = m_frames.back();
+    const Chunk& chunk = frame.closure->function->chunk;
+    std::size_t offset =
+        static_cast<std::size_t>( frame.ip - chunk.code.data() - 1 );
+
+    return Error::RuntimeError{
+        Token{ TokenType::IDENTIFIER, "", Object{ std::monostate{} },
+               chunk.getLine( offset ) },
+        message };
+}
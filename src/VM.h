@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Error.h"
+#include "GlobalTable.h"
+#include "Object.h"
+#include "Symbol.h"
+#include "VMObject.h"
+
+class Interpreter;
+
+// Stack-based bytecode interpreter for chunks produced by the Compiler.
+// Globals persist across calls to interpret() so the REPL keeps its state.
+class VM
+{
+public:
+    VM( Interpreter& host );
+
+    void interpret( std::shared_ptr<VMFunction> script );
+    GlobalTable& getGlobals();
+
+private:
+    struct CallFrame
+    {
+        // The closure is kept alive by the callee slot, or by the receiver's
+        // class for method calls.
+        VMClosure* closure;
+        const std::uint8_t* ip;
+        std::size_t base;
+    };
+
+    void run();
+    void push( Object value );
+    Object pop();
+    Object& peek( std::size_t distance );
+    void truncate( std::size_t top );
+    void resetStack();
+
+    void callValue( const Object& callee, int argCount );
+    void call( VMClosure* closure, int argCount );
+    void invoke( Symbol name, int argCount );
+    void invokeFromClass( VMClass* klass, Symbol name, int argCount );
+    void bindMethod( VMClass* klass, Symbol name );
+    Ref<VMUpvalue> captureUpvalue( std::size_t slot );
+    void closeUpvalues( std::size_t last );
+    void defineMethod( Symbol name );
+
+    bool isTruthy( const Object& object ) const;
+    bool isEqual( const Object& a, const Object& b ) const;
+    Error::RuntimeError error( const std::string& message ) const;
+
+    std::vector<Object> m_stack;
+    std::size_t m_top{ 0 };
+    std::vector<CallFrame> m_frames{};
+    std::vector<Ref<VMUpvalue>> m_openUpvalues{};
+    GlobalTable m_globals{};
+
+    // Natives share the tree-walker's LoxCallable interface and take the host
+    // interpreter as their first argument.
+    Interpreter& m_host;
+};
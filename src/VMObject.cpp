@@ -0,0 +1,101 @@
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Object.h"
+#include "VMObject.h"
+
+int VMClosure::arity() const
+{
+    return function->arity;
+}
+
+Object VMClosure::call( [[maybe_unused]] Interpreter& interpreter,
+                        [[maybe_unused]] Span<const Object> arguments )
+{
+    throw std::logic_error{ "VM closures can only be called by the VM." };
+}
+
+std::string VMClosure::toString() const
+{
+    return "<fn " + function->name + ">";
+}
+
+void VMClosure::traverse( HeapVisitor& visitor ) const
+{
+    for ( const auto& upvalue : upvalues )
+        visitor.visit( upvalue );
+}
+
+void VMClosure::clear()
+{
+    upvalues.clear();
+}
+
+int VMClass::arity() const
+{
+    if ( !initializer )
+        return 0;
+    return initializer->arity();
+}
+
+Object VMClass::call( [[maybe_unused]] Interpreter& interpreter,
+                      [[maybe_unused]] Span<const Object> arguments )
+{
+    throw std::logic_error{ "VM classes can only be called by the VM." };
+}
+
+void VMClass::traverse( HeapVisitor& visitor ) const
+{
+    LoxClass::traverse( visitor );
+    for ( const auto& [name, method] : methods )
+        visitor.visit( method );
+    visitor.visit( initializer );
+}
+
+void VMClass::clear()
+{
+    LoxClass::clear();
+    methods.clear();
+    initializer = nullptr;
+}
+
+int VMBoundMethod::arity() const
+{
+    return method->arity();
+}
+
+Object VMBoundMethod::call(
+    [[maybe_unused]] Interpreter& interpreter,
+    [[maybe_unused]] Span<const Object> arguments )
+{
+    throw std::logic_error{ "VM methods can only be called by the VM." };
+}
+
+std::string VMBoundMethod::toString() const
+{
+    return method->toString();
+}
+
+void VMBoundMethod::traverse( HeapVisitor& visitor ) const
+{
+    visitor.visit( receiver );
+    visitor.visit( method );
+}
+
+void VMBoundMethod::clear()
+{
+    receiver = std::monostate{};
+    method = nullptr;
+}
+
+void VMUpvalue::traverse( HeapVisitor& visitor ) const
+{
+    visitor.visit( closed );
+}
+
+void VMUpvalue::clear()
+{
+    closed = std::monostate{};
+}
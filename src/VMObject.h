@@ -0,0 +1,100 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Chunk.h"
+#include "HeapObject.h"
+#include "LoxCallable.h"
+#include "LoxClass.h"
+#include "Object.h"
+#include "Symbol.h"
+
+class Interpreter;
+
+// Runtime objects of the bytecode VM. They plug into the same Object
+// representation as the tree-walker's callables so printing, equality and natives
+// are shared, but they are only ever invoked by the VM's own dispatch loop.
+
+struct VMFunction
+{
+    std::string name{};
+    int arity{ 0 };
+    int upvalueCount{ 0 };
+    Chunk chunk{};
+};
+
+// A captured variable. While open it aliases a live VM stack slot; when that
+// slot goes out of scope the value is moved into 'closed'.
+struct VMUpvalue : public HeapObject
+{
+    VMUpvalue( std::size_t slot ) : HeapObject{ Kind::VM_UPVALUE }, slot{ slot }
+    {
+    }
+
+    void traverse( HeapVisitor& visitor ) const override;
+    void clear() override;
+
+    std::size_t slot{ 0 };
+    bool isOpen{ true };
+    Object closed{ std::monostate{} };
+};
+
+class VMClosure : public LoxCallable
+{
+public:
+    VMClosure( std::shared_ptr<VMFunction> function )
+        : LoxCallable{ Kind::VM_CLOSURE }, function{ function }, upvalues( function->upvalueCount )
+    {
+    }
+
+    int arity() const override;
+    Object call( Interpreter& interpreter,
+                 Span<const Object> arguments ) override;
+    std::string toString() const override;
+    void traverse( HeapVisitor& visitor ) const override;
+    void clear() override;
+
+    std::shared_ptr<VMFunction> function;
+    std::vector<Ref<VMUpvalue>> upvalues;
+};
+
+class VMClass : public LoxClass
+{
+public:
+    VMClass( const std::string& name )
+        : LoxClass{ Kind::VM_CLASS, name, nullptr, {} }
+    {
+    }
+
+    int arity() const override;
+    Object call( Interpreter& interpreter,
+                 Span<const Object> arguments ) override;
+    void traverse( HeapVisitor& visitor ) const override;
+    void clear() override;
+
+    // Inherited methods are copied down by INHERIT, so a single lookup
+    // finds any method in the hierarchy.
+    std::unordered_map<Symbol, Ref<VMClosure>> methods{};
+    Ref<VMClosure> initializer{ nullptr };
+};
+
+class VMBoundMethod : public LoxCallable
+{
+public:
+    VMBoundMethod( const Object& receiver, Ref<VMClosure> method )
+        : LoxCallable{ Kind::VM_BOUND_METHOD }, receiver{ receiver }, method{ method }
+    {
+    }
+
+    int arity() const override;
+    Object call( Interpreter& interpreter,
+                 Span<const Object> arguments ) override;
+    std::string toString() const override;
+    void traverse( HeapVisitor& visitor ) const override;
+    void clear() override;
+
+    Object receiver;
+    Ref<VMClosure> method;
+};
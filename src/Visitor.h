@@ -1,5 +1,8 @@
 #pragma once
 
+class Object;
+struct Completion;
+
 struct Assign;
 struct Binary;
 struct Call;
@@ -23,7 +26,7 @@ struct Return;
 struct Var;
 struct While;
 
-struct IVisitor
+struct IExprVisitor
 {
     virtual void visit( Assign* ) = 0;
     virtual void visit( Binary* ) = 0;
@@ -38,6 +41,13 @@ struct IVisitor
     virtual void visit( Unary* ) = 0;
     virtual void visit( Variable* ) = 0;
 
+    virtual ~IExprVisitor()
+    {
+    }
+};
+
+struct IStmtVisitor
+{
     virtual void visit( Block* ) = 0;
     virtual void visit( ClassStmt* ) = 0;
     virtual void visit( Expression* ) = 0;
@@ -48,7 +58,55 @@ struct IVisitor
     virtual void visit( Var* ) = 0;
     virtual void visit( While* ) = 0;
 
-    virtual ~IVisitor()
+    virtual ~IStmtVisitor()
+    {
+    }
+};
+
+// Walks both expressions and statements.
+struct IVisitor : public IExprVisitor, public IStmtVisitor
+{
+    using IExprVisitor::visit;
+    using IStmtVisitor::visit;
+};
+
+// Expression visitor that produces a value, so an evaluator can return
+// results directly instead of passing them through a member.
+struct IValueVisitor
+{
+    virtual Object visit( Assign* ) = 0;
+    virtual Object visit( Binary* ) = 0;
+    virtual Object visit( Call* ) = 0;
+    virtual Object visit( Get* ) = 0;
+    virtual Object visit( Grouping* ) = 0;
+    virtual Object visit( Literal* ) = 0;
+    virtual Object visit( Logical* ) = 0;
+    virtual Object visit( Set* ) = 0;
+    virtual Object visit( Super* ) = 0;
+    virtual Object visit( This* ) = 0;
+    virtual Object visit( Unary* ) = 0;
+    virtual Object visit( Variable* ) = 0;
+
+    virtual ~IValueVisitor()
+    {
+    }
+};
+
+// Statement visitor that reports how each statement completed, so a return
+// can reach its caller without an exception.
+struct ICompletionVisitor
+{
+    virtual Completion visit( Block* ) = 0;
+    virtual Completion visit( ClassStmt* ) = 0;
+    virtual Completion visit( Expression* ) = 0;
+    virtual Completion visit( Function* ) = 0;
+    virtual Completion visit( If* ) = 0;
+    virtual Completion visit( Print* ) = 0;
+    virtual Completion visit( Return* ) = 0;
+    virtual Completion visit( Var* ) = 0;
+    virtual Completion visit( While* ) = 0;
+
+    virtual ~ICompletionVisitor()
     {
     }
-};
\ No newline at end of file
+};
@@ -1,18 +1,90 @@
+#include <cstddef>
 #include <cstdlib>
 #include <iostream>
+#include <string>
 
 #include "Driver.h"
+#include "GC.h"
+#include "Jit.h"
+#include "PassManager.h"
+#include "Pool.h"
 
-int main( int argc, char** argv )
+namespace
 {
-    if ( argc > 2 )
+    [[noreturn]] void usage()
     {
-        std::cout << "Usage: cpplox [script]\n";
+        std::cout << "Usage: cpplox [--backend=tree|closure|vm] "
+                     "[-O0|-O1|-O2] [--pass-stats] [--jit] [--jit-stats] "
+                     "[--gc-stats] [--gc-threshold=N] [--pool-stats] "
+                     "[script]\n";
         std::exit( 64 );
     }
-    else if ( argc == 2 )
+
+    std::size_t parseCount( const std::string& text )
+    {
+        if ( text.empty() ||
+             text.find_first_not_of( "0123456789" ) != std::string::npos )
+            usage();
+
+        return std::stoul( text );
+    }
+} // namespace
+
+int main( int argc, char** argv )
+{
+    std::string script{};
+
+    for ( int i = 1; i < argc; ++i )
+    {
+        std::string arg{ argv[i] };
+
+        if ( arg == "--backend=vm" )
+            Driver::backend = Driver::Backend::VM;
+        else if ( arg == "--backend=tree" )
+            Driver::backend = Driver::Backend::TREE_WALKER;
+        else if ( arg == "--backend=closure" )
+            Driver::backend = Driver::Backend::CLOSURES;
+        else if ( arg == "-O0" || arg == "-O1" || arg == "-O2" )
+            Passes::config.level = arg[2] - '0';
+        else if ( arg == "--pass-stats" )
+        {
+            Passes::config.stats = true;
+            std::atexit( [] { Passes::printStats( std::cerr ); } );
+        }
+        else if ( arg == "--jit" )
+        {
+            if ( Jit::isSupported() )
+                Jit::config.enabled = true;
+            else
+                std::cerr << "cpplox: --jit needs an x86-64 build with NaN "
+                             "boxing, running without it.\n";
+        }
+        else if ( arg == "--jit-stats" )
+            std::atexit( [] { Jit::printStats( std::cerr ); } );
+        else if ( arg == "--gc-stats" )
+            std::atexit( [] { GC::printStats( std::cerr ); } );
+        else if ( arg == "--pool-stats" )
+            std::atexit( [] { Pool::printStats( std::cerr ); } );
+        else if ( arg.rfind( "--gc-threshold=", 0 ) == 0 )
+            GC::config.thresholds[0] = parseCount( arg.substr( 15 ) );
+        else if ( arg.rfind( "--", 0 ) == 0 || !script.empty() )
+            usage();
+        else
+            script = arg;
+    }
+
+    // Only the tree-walker and the closure backend call through
+    // LoxFunction, where compiled code is run.
+    if ( Jit::config.enabled && Driver::backend == Driver::Backend::VM )
+    {
+        std::cerr << "cpplox: --jit does not apply to the vm backend, "
+                     "running without it.\n";
+        Jit::config.enabled = false;
+    }
+
+    if ( !script.empty() )
     {
-        Driver::runFile( argv[1] );
+        Driver::runFile( script );
     }
     else
     {
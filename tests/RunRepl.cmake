@@ -0,0 +1,14 @@
+# Feeds INPUT to the REPL of CPPLOX, run with ARGS, and checks that what it
+# prints to stdout, without the prompts, matches EXPECTED. Runtime errors go
+# to stderr and are not compared.
+separate_arguments(ARGS)
+execute_process(
+    COMMAND ${CPPLOX} ${ARGS}
+    INPUT_FILE ${INPUT}
+    OUTPUT_VARIABLE output
+    ERROR_QUIET)
+string(REPLACE "> " "" output "${output}")
+file(READ ${EXPECTED} expected)
+if(NOT output STREQUAL expected)
+    message(FATAL_ERROR "Expected:\n${expected}\nGot:\n${output}")
+endif()